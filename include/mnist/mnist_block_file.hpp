@@ -0,0 +1,424 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains a block-compressed on-disk format for MNIST-style files
+ *
+ * A block file stores the records (images or labels) of an IDX file in
+ * blocks of a fixed number of records, each compressed independently
+ * with the LZ codec of mnist_lz.hpp. All the values are little endian:
+ *
+ * - "MNBC" magic and format version (u32)
+ * - size of the IDX header (u32), records per block (u32), record size (u32)
+ * - number of records (u64), number of blocks (u64)
+ * - the original IDX header
+ * - the block index: file offset (u64), compressed size (u32) and raw size (u32) of each block
+ * - the compressed blocks
+ *
+ * The block index allows random access to any record and parallel
+ * decompression of the whole file.
+ */
+
+#ifndef MNIST_BLOCK_FILE_HPP
+#define MNIST_BLOCK_FILE_HPP
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#include "mnist_reader_common.hpp"
+#include "mnist_lz.hpp"
+#include "mnist_parallel.hpp"
+
+namespace mnist {
+
+constexpr uint32_t block_file_version = 1; ///< The version of the block file format
+
+namespace detail {
+
+inline void put_le(std::vector<uint8_t>& out, uint64_t value, std::size_t bytes) {
+    for (std::size_t i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+inline uint64_t get_le(const uint8_t* in, std::size_t bytes) {
+    uint64_t value = 0;
+    for (std::size_t i = 0; i < bytes; ++i) {
+        value |= uint64_t(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+inline uint32_t get_be32(const uint8_t* in) {
+    return (uint32_t(in[0]) << 24) | (uint32_t(in[1]) << 16) | (uint32_t(in[2]) << 8) | uint32_t(in[3]);
+}
+
+constexpr std::size_t block_file_header_size = 36;
+constexpr std::size_t block_entry_size       = 16;
+
+} //end of namespace detail
+
+/*!
+ * \brief The position of one block inside a block file
+ */
+struct block_entry {
+    uint64_t offset;     ///< The offset of the compressed block in the file
+    uint32_t compressed; ///< The compressed size of the block
+    uint32_t raw;        ///< The decompressed size of the block
+};
+
+/*!
+ * \brief Write records to a block file
+ * \param path The path of the block file to write
+ * \param header The IDX header of the records
+ * \param header_size The size of the IDX header
+ * \param records The contiguous records
+ * \param count The number of records
+ * \param record_size The size of one record
+ * \param records_per_block The number of records in each block
+ * \param threads The number of threads used for compression (0: hardware concurrency)
+ * \return true on success, false otherwise
+ */
+inline bool write_block_file(const std::string& path, const uint8_t* header, std::size_t header_size, const uint8_t* records, std::size_t count,
+                             std::size_t record_size, std::size_t records_per_block = 1024, std::size_t threads = 0) {
+    if (!records_per_block) {
+        records_per_block = 1;
+    }
+
+    // The sizes of the header and of the raw blocks are stored on 32 bits
+    if (header_size > 0xFFFFFFFF || (record_size && records_per_block > 0xFFFFFFFF / record_size)) {
+        std::cout << "The blocks are too large for the block file format" << std::endl;
+        return false;
+    }
+
+    const std::size_t n_blocks = (count + records_per_block - 1) / records_per_block;
+
+    std::vector<std::vector<uint8_t>> blocks(n_blocks);
+
+    parallel_for(0, n_blocks, [&](std::size_t b) {
+        std::size_t first = b * records_per_block;
+        std::size_t n     = std::min(records_per_block, count - first);
+        lz_compress(records + first * record_size, n * record_size, blocks[b]);
+    }, threads);
+
+    std::vector<uint8_t> head;
+    head.insert(head.end(), {'M', 'N', 'B', 'C'});
+    detail::put_le(head, block_file_version, 4);
+    detail::put_le(head, header_size, 4);
+    detail::put_le(head, records_per_block, 4);
+    detail::put_le(head, record_size, 4);
+    detail::put_le(head, count, 8);
+    detail::put_le(head, n_blocks, 8);
+    head.insert(head.end(), header, header + header_size);
+
+    uint64_t offset = head.size() + n_blocks * detail::block_entry_size;
+
+    for (std::size_t b = 0; b < n_blocks; ++b) {
+        std::size_t n = std::min(records_per_block, count - b * records_per_block);
+
+        detail::put_le(head, offset, 8);
+        detail::put_le(head, blocks[b].size(), 4);
+        detail::put_le(head, n * record_size, 4);
+
+        offset += blocks[b].size();
+    }
+
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!file) {
+        std::cout << "Error opening file" << std::endl;
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(head.data()), head.size());
+
+    for (auto& block : blocks) {
+        file.write(reinterpret_cast<const char*>(block.data()), block.size());
+    }
+
+    return static_cast<bool>(file);
+}
+
+/*!
+ * \brief Compress a MNIST (IDX) file into a block file
+ * \param idx_path The path to the MNIST file
+ * \param key The expected magic number of the MNIST file (0x803 for images, 0x801 for labels)
+ * \param path The path of the block file to write
+ * \param records_per_block The number of records in each block
+ * \param threads The number of threads used for compression (0: hardware concurrency)
+ * \return true on success, false otherwise
+ */
+inline bool compress_mnist_file(const std::string& idx_path, uint32_t key, const std::string& path, std::size_t records_per_block = 1024, std::size_t threads = 0) {
+    auto buffer = read_mnist_file(idx_path, key);
+
+    if (buffer) {
+        // The low byte of the magic number is the number of dimensions
+        std::size_t dimensions  = key & 0xFF;
+        std::size_t header_size = 4 + 4 * dimensions;
+        std::size_t count       = read_header(buffer, 1);
+        std::size_t record_size = 1;
+
+        for (std::size_t d = 1; d < dimensions; ++d) {
+            record_size *= read_header(buffer, 1 + d);
+        }
+
+        auto data = reinterpret_cast<const uint8_t*>(buffer.get());
+
+        return write_block_file(path, data, header_size, data + header_size, count, record_size, records_per_block, threads);
+    } else {
+        return false;
+    }
+}
+
+/*!
+ * \brief A block file opened for reading
+ *
+ * Only the header and the block index are kept in memory, the blocks are
+ * read and decompressed on demand.
+ */
+struct block_file {
+    std::string path;                ///< The path to the file
+    std::vector<uint8_t> idx_header; ///< The original IDX header
+    std::vector<block_entry> blocks; ///< The block index
+    std::size_t records_per_block = 0; ///< The number of records in each block
+    std::size_t record_size       = 0; ///< The size of one record
+    std::size_t count             = 0; ///< The number of records
+
+    /*!
+     * \brief Open the block file and read its index
+     * \param file_path The path to the block file
+     * \return true on success, false otherwise
+     */
+    bool open(const std::string& file_path) {
+        std::ifstream file(file_path, std::ios::in | std::ios::binary);
+
+        if (!file) {
+            std::cout << "Error opening file" << std::endl;
+            return false;
+        }
+
+        uint8_t head[detail::block_file_header_size];
+        file.read(reinterpret_cast<char*>(head), sizeof(head));
+
+        if (!file || head[0] != 'M' || head[1] != 'N' || head[2] != 'B' || head[3] != 'C' || detail::get_le(head + 4, 4) != block_file_version) {
+            std::cout << "Invalid magic number, probably not a MNIST block file" << std::endl;
+            return false;
+        }
+
+        std::size_t header_size = detail::get_le(head + 8, 4);
+        records_per_block       = detail::get_le(head + 12, 4);
+        record_size             = detail::get_le(head + 16, 4);
+        count                   = detail::get_le(head + 20, 8);
+
+        std::size_t n_blocks = detail::get_le(head + 28, 8);
+
+        file.seekg(0, std::ios::end);
+        const uint64_t file_size = static_cast<uint64_t>(file.tellg());
+        file.seekg(detail::block_file_header_size, std::ios::beg);
+
+        // Check the sizes before allocating anything from them
+        const uint64_t index_end = detail::block_file_header_size + uint64_t(header_size) + uint64_t(n_blocks) * detail::block_entry_size;
+
+        if (!records_per_block || !record_size || n_blocks > file_size || index_end > file_size
+            || n_blocks != (count + records_per_block - 1) / records_per_block) {
+            std::cout << "The file is not large enough to hold all the data, probably corrupted" << std::endl;
+            return false;
+        }
+
+        idx_header.resize(header_size);
+        file.read(reinterpret_cast<char*>(idx_header.data()), header_size);
+
+        std::vector<uint8_t> index(n_blocks * detail::block_entry_size);
+        file.read(reinterpret_cast<char*>(index.data()), index.size());
+
+        if (!file) {
+            std::cout << "The file is not large enough to hold all the data, probably corrupted" << std::endl;
+            return false;
+        }
+
+        blocks.resize(n_blocks);
+
+        for (std::size_t b = 0; b < n_blocks; ++b) {
+            const uint8_t* entry = index.data() + b * detail::block_entry_size;
+
+            blocks[b].offset     = detail::get_le(entry, 8);
+            blocks[b].compressed = static_cast<uint32_t>(detail::get_le(entry + 8, 4));
+            blocks[b].raw        = static_cast<uint32_t>(detail::get_le(entry + 12, 4));
+
+            // Every block but the last one is full
+            const uint64_t expected = uint64_t(std::min<std::size_t>(records_per_block, count - b * records_per_block)) * record_size;
+
+            if (blocks[b].raw != expected || blocks[b].offset > file_size || blocks[b].compressed > file_size - blocks[b].offset) {
+                std::cout << "Invalid block index, probably corrupted" << std::endl;
+                return false;
+            }
+        }
+
+        path = file_path;
+
+        return true;
+    }
+
+    /*!
+     * \brief Read and decompress one block
+     * \param file A stream opened on the block file
+     * \param b The index of the block
+     * \param dst The output buffer
+     * \param capacity The size of the output buffer (at least blocks[b].raw bytes)
+     * \return true on success, false otherwise
+     */
+    bool read_block(std::ifstream& file, std::size_t b, uint8_t* dst, std::size_t capacity) const {
+        if (blocks[b].raw > capacity) {
+            std::cout << "Invalid block size, probably corrupted" << std::endl;
+            return false;
+        }
+
+        std::vector<uint8_t> compressed(blocks[b].compressed);
+
+        file.seekg(blocks[b].offset, std::ios::beg);
+        file.read(reinterpret_cast<char*>(compressed.data()), compressed.size());
+
+        if (!file || lz_decompress(compressed.data(), compressed.size(), dst, capacity) != blocks[b].raw) {
+            std::cout << "Invalid compressed block, probably corrupted" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    /*!
+     * \brief Read a range of records
+     * \param first The index of the first record
+     * \param n The number of records
+     * \param dst The output buffer (n * record_size bytes)
+     * \return true on success, false otherwise
+     */
+    bool read_records(std::size_t first, std::size_t n, uint8_t* dst) const {
+        if (first + n > count) {
+            return false;
+        }
+
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+
+        if (!file) {
+            std::cout << "Error opening file" << std::endl;
+            return false;
+        }
+
+        std::vector<uint8_t> raw(records_per_block * record_size);
+
+        std::size_t i = first;
+        while (i < first + n) {
+            std::size_t b     = i / records_per_block;
+            std::size_t start = i - b * records_per_block;
+            std::size_t take  = std::min(first + n - i, records_per_block - start);
+
+            if (!read_block(file, b, raw.data(), raw.size())) {
+                return false;
+            }
+
+            std::copy(raw.begin() + start * record_size, raw.begin() + (start + take) * record_size, dst + (i - first) * record_size);
+
+            i += take;
+        }
+
+        return true;
+    }
+
+    /*!
+     * \brief Read all the records, decompressing the blocks in parallel
+     * \param dst The output buffer (count * record_size bytes)
+     * \param threads The number of threads to use (0: hardware concurrency)
+     * \return true on success, false otherwise
+     */
+    bool read_all(uint8_t* dst, std::size_t threads = 0) const {
+        std::vector<char> status(blocks.size(), 0);
+
+        parallel_for_chunks(0, blocks.size(), [&](std::size_t begin, std::size_t end) {
+            std::ifstream file(path, std::ios::in | std::ios::binary);
+
+            for (std::size_t b = begin; b < end && file; ++b) {
+                const std::size_t offset = b * records_per_block * record_size;
+                status[b]                = read_block(file, b, dst + offset, count * record_size - offset);
+            }
+        }, threads);
+
+        for (auto s : status) {
+            if (!s) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+/*!
+ * \brief Read a block file back into a MNIST (IDX) buffer
+ *
+ * The returned buffer has the same layout as the one returned by
+ * read_mnist_file.
+ *
+ * \param path The path to the block file
+ * \param key The expected magic number of the MNIST data
+ * \param threads The number of threads to use (0: hardware concurrency)
+ * \return The buffer of byte on success, a nullptr-unique_ptr otherwise
+ */
+inline std::unique_ptr<char[]> read_mnist_block_file(const std::string& path, uint32_t key, std::size_t threads = 0) {
+    block_file file;
+
+    if (!file.open(path)) {
+        return {};
+    }
+
+    if (file.idx_header.size() < 8 || detail::get_be32(file.idx_header.data()) != key) {
+        std::cout << "Invalid magic number, probably not a MNIST file" << std::endl;
+        return {};
+    }
+
+    // The decoders trust the IDX header, it must describe exactly the records of the index
+    const std::size_t dimensions = key & 0xFF;
+
+    uint64_t record_size = 1;
+    bool valid           = file.idx_header.size() == 4 + 4 * dimensions && detail::get_be32(file.idx_header.data() + 4) == file.count;
+
+    for (std::size_t d = 1; valid && d < dimensions; ++d) {
+        record_size *= detail::get_be32(file.idx_header.data() + 4 + 4 * d);
+        valid = record_size <= file.record_size;
+    }
+
+    if (!valid || record_size != file.record_size) {
+        std::cout << "The IDX header does not match the block index, probably corrupted" << std::endl;
+        return {};
+    }
+
+    const std::size_t size = file.idx_header.size() + file.count * file.record_size;
+
+    std::unique_ptr<char[]> buffer(new char[size]);
+
+    std::copy(file.idx_header.begin(), file.idx_header.end(), buffer.get());
+
+    if (!file.read_all(reinterpret_cast<uint8_t*>(buffer.get() + file.idx_header.size()), threads)) {
+        return {};
+    }
+
+    if (!check_mnist_buffer(buffer.get(), size, key)) {
+        return {};
+    }
+
+    return buffer;
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,237 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains a bounded LRU cache of transformed samples
+ *
+ * Deterministic transforms (deskewing, downsampling, feature extraction,
+ * ...) give the same result at every epoch. The cache keeps their results,
+ * keyed by (sample index, transform id), within a memory budget and evicts
+ * the least recently used entries first.
+ */
+
+#ifndef MNIST_CACHE_HPP
+#define MNIST_CACHE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mnist {
+
+/*!
+ * \brief A bounded LRU cache of transformed samples
+ *
+ * All the operations are thread-safe, the cache can be shared by the
+ * threads of parallel_for. The values are copied in and out of the cache,
+ * so an entry evicted by another thread never invalidates a result.
+ */
+template <typename T>
+struct transform_cache {
+    /*!
+     * \brief Construct a cache
+     *
+     * The budget includes the bookkeeping of each entry (list and map
+     * nodes, vector header), so that caching many small values does not
+     * use much more memory than the budget.
+     *
+     * \param max_bytes The maximum memory used by the entries, in bytes
+     */
+    explicit transform_cache(std::size_t max_bytes) : max_bytes(max_bytes) {}
+
+    /*!
+     * \brief Look for the transformed sample in the cache
+     * \param index The index of the sample
+     * \param transform The id of the transform
+     * \param value The output value
+     * \return true if the value was found, false otherwise
+     */
+    bool lookup(std::size_t index, uint32_t transform, std::vector<T>& value) {
+        std::lock_guard<std::mutex> l(lock);
+
+        auto it = map.find(key_type(index, transform));
+
+        if (it == map.end()) {
+            ++miss_count;
+            return false;
+        }
+
+        ++hit_count;
+
+        entries.splice(entries.begin(), entries, it->second);
+        value = it->second->value;
+
+        return true;
+    }
+
+    /*!
+     * \brief Insert a transformed sample in the cache
+     *
+     * Values larger than the budget are not cached.
+     *
+     * \param index The index of the sample
+     * \param transform The id of the transform
+     * \param value The value to cache
+     */
+    void insert(std::size_t index, uint32_t transform, std::vector<T> value) {
+        value.shrink_to_fit();
+
+        const std::size_t bytes = entry_bytes(value);
+
+        if (bytes > max_bytes) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> l(lock);
+
+        key_type key(index, transform);
+
+        auto it = map.find(key);
+
+        if (it != map.end()) {
+            current_bytes -= entry_bytes(it->second->value);
+            entries.erase(it->second);
+            map.erase(it);
+        }
+
+        while (current_bytes + bytes > max_bytes && !entries.empty()) {
+            current_bytes -= entry_bytes(entries.back().value);
+            map.erase(entries.back().key);
+            entries.pop_back();
+        }
+
+        entries.push_front(entry{key, std::move(value)});
+        map[key] = entries.begin();
+        current_bytes += bytes;
+    }
+
+    /*!
+     * \brief Get the transformed sample, computing and caching it on a miss
+     *
+     * The transform is computed outside of the lock, so several threads
+     * can compute different samples at the same time.
+     *
+     * \param index The index of the sample
+     * \param transform The id of the transform
+     * \param value The output value
+     * \param compute The functor computing the value, called as compute(value)
+     */
+    template <typename Functor>
+    void get(std::size_t index, uint32_t transform, std::vector<T>& value, Functor compute) {
+        if (lookup(index, transform, value)) {
+            return;
+        }
+
+        compute(value);
+        insert(index, transform, value);
+    }
+
+    /*!
+     * \brief Remove all the entries of the cache
+     */
+    void clear() {
+        std::lock_guard<std::mutex> l(lock);
+
+        entries.clear();
+        map.clear();
+        current_bytes = 0;
+    }
+
+    /*!
+     * \brief Reset the hit and miss counters
+     */
+    void reset_counters() {
+        std::lock_guard<std::mutex> l(lock);
+
+        hit_count  = 0;
+        miss_count = 0;
+    }
+
+    /*!
+     * \brief Return the number of lookups that found their value
+     */
+    std::size_t hits() const {
+        std::lock_guard<std::mutex> l(lock);
+        return hit_count;
+    }
+
+    /*!
+     * \brief Return the number of lookups that did not find their value
+     */
+    std::size_t misses() const {
+        std::lock_guard<std::mutex> l(lock);
+        return miss_count;
+    }
+
+    /*!
+     * \brief Return the fraction of lookups that found their value
+     */
+    double hit_rate() const {
+        std::lock_guard<std::mutex> l(lock);
+        return hit_count + miss_count ? double(hit_count) / (hit_count + miss_count) : 0.0;
+    }
+
+    /*!
+     * \brief Return the number of cached entries
+     */
+    std::size_t size() const {
+        std::lock_guard<std::mutex> l(lock);
+        return map.size();
+    }
+
+    /*!
+     * \brief Return the memory used by the entries, in bytes
+     */
+    std::size_t bytes() const {
+        std::lock_guard<std::mutex> l(lock);
+        return current_bytes;
+    }
+
+private:
+    using key_type = std::pair<std::size_t, uint32_t>;
+
+    struct entry {
+        key_type key;
+        std::vector<T> value;
+    };
+
+    /*!
+     * \brief Return the memory used by an entry: its value, its list node,
+     * its map node and bucket, and one allocator header per allocation
+     */
+    static std::size_t entry_bytes(const std::vector<T>& value) {
+        return value.capacity() * sizeof(T) + sizeof(entry) + 2 * sizeof(void*)
+             + sizeof(key_type) + sizeof(typename std::list<entry>::iterator) + 3 * sizeof(void*)
+             + 3 * 2 * sizeof(void*);
+    }
+
+    struct key_hash {
+        std::size_t operator()(const key_type& key) const {
+            return std::hash<uint64_t>()((uint64_t(key.first) << 8) ^ (uint64_t(key.second) * 0x9E3779B97F4A7C15ull));
+        }
+    };
+
+    std::size_t max_bytes;         ///< The budget of the cache, in bytes
+    std::size_t current_bytes = 0; ///< The memory used by the entries, in bytes
+    std::size_t hit_count     = 0; ///< The number of hits
+    std::size_t miss_count    = 0; ///< The number of misses
+
+    std::list<entry> entries; ///< The entries, most recently used first
+    std::unordered_map<key_type, typename std::list<entry>::iterator, key_hash> map;
+
+    mutable std::mutex lock;
+};
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,91 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains one-hot encoding of labels with label smoothing
+ *
+ * The rows are written in a single pass with a branchless comparison,
+ * which the compiler vectorizes, and the output buffer does not need to
+ * be zeroed before.
+ */
+
+#ifndef MNIST_CATEGORICAL_HPP
+#define MNIST_CATEGORICAL_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace mnist {
+
+namespace detail {
+
+template <typename T>
+void encode_categorical_row(std::size_t label, std::size_t classes, T* out, T on, T off) {
+    assert(label < classes && "The label is not a valid class");
+
+    // An invalid label has no class to put the probability mass on
+    if (label >= classes) {
+        std::fill(out, out + classes, T(0));
+        return;
+    }
+
+    for (std::size_t c = 0; c < classes; ++c) {
+        out[c] = c == label ? on : off;
+    }
+}
+
+} //end of namespace detail
+
+/*!
+ * \brief Encode labels as one-hot rows, with optional label smoothing
+ *
+ * With smoothing, the value of the true class is 1 - epsilon + epsilon / classes
+ * and the value of the other classes is epsilon / classes. The labels must
+ * be smaller than classes: this is asserted and, without assertions, the
+ * row of an invalid label is all zeros.
+ *
+ * \param labels The labels to encode
+ * \param n The number of labels
+ * \param classes The number of classes
+ * \param out The output rows (n * classes values)
+ * \param epsilon The label smoothing factor (0: plain one-hot)
+ */
+template <typename Label, typename T>
+void encode_categorical(const Label* labels, std::size_t n, std::size_t classes, T* out, typename std::common_type<T>::type epsilon = T(0)) {
+    const T off = epsilon / static_cast<T>(classes);
+    const T on  = T(1) - epsilon + off;
+
+    for (std::size_t i = 0; i < n; ++i) {
+        detail::encode_categorical_row(static_cast<std::size_t>(labels[i]), classes, out + i * classes, on, off);
+    }
+}
+
+/*!
+ * \brief Encode the labels of a batch of samples as one-hot rows, with optional label smoothing
+ * \param labels The labels of the dataset
+ * \param indices The indices of the samples of the batch
+ * \param classes The number of classes
+ * \param out The output rows (indices.size() * classes values)
+ * \param epsilon The label smoothing factor (0: plain one-hot)
+ */
+template <typename Label, typename T>
+void encode_categorical_batch(const Label* labels, const std::vector<std::size_t>& indices, std::size_t classes, T* out, typename std::common_type<T>::type epsilon = T(0)) {
+    const T off = epsilon / static_cast<T>(classes);
+    const T on  = T(1) - epsilon + off;
+
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        detail::encode_categorical_row(static_cast<std::size_t>(labels[indices[i]]), classes, out + i * classes, on, off);
+    }
+}
+
+} //end of namespace mnist
+
+#endif
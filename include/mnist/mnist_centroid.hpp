@@ -0,0 +1,217 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains per-class statistics and nearest-centroid classification
+ *
+ * The statistics are accumulated in a single pass over the images, each
+ * thread accumulating the sums and the sums of squares of its own images
+ * before the partial sums are merged. For integral pixels, the sums are
+ * accumulated exactly in integers.
+ */
+
+#ifndef MNIST_CENTROID_HPP
+#define MNIST_CENTROID_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "mnist_parallel.hpp"
+#include "mnist_simd.hpp"
+
+namespace mnist {
+
+/*!
+ * \brief The per-class mean and variance images
+ */
+struct MNIST_centroids {
+    std::size_t classes  = 0;        ///< The number of classes
+    std::size_t features = 0;        ///< The number of pixels of each image
+    std::vector<std::size_t> counts; ///< The number of samples of each class
+    std::vector<float> means;        ///< The mean image of each class (classes x features)
+    std::vector<float> variances;    ///< The variance image of each class (classes x features)
+    std::vector<float> norms;        ///< The squared norm of each mean image (classes)
+};
+
+/*!
+ * \brief Compute the mean and variance image of each class
+ * \param centroids The statistics to compute
+ * \param images The contiguous images (n * features pixels)
+ * \param labels The labels (n labels)
+ * \param n The number of samples
+ * \param features The number of pixels of each image
+ * \param classes The number of classes (0: the largest label + 1), samples with a larger label are ignored
+ * \param threads The number of threads to use (0: hardware concurrency)
+ */
+template <typename Pixel, typename Label>
+void compute_centroids(MNIST_centroids& centroids, const Pixel* images, const Label* labels, std::size_t n, std::size_t features, std::size_t classes = 0, std::size_t threads = 0) {
+    using sum_type = typename std::conditional<std::is_integral<Pixel>::value, uint64_t, double>::type;
+
+    if (!classes) {
+        for (std::size_t i = 0; i < n; ++i) {
+            classes = std::max(classes, static_cast<std::size_t>(labels[i]) + 1);
+        }
+    }
+
+    if (!threads) {
+        threads = default_threads();
+    }
+
+    threads = std::max<std::size_t>(std::min(threads, n), 1);
+
+    const std::size_t size = classes * features;
+
+    // One set of partial sums per thread
+    std::vector<std::vector<sum_type>> sums(threads, std::vector<sum_type>(size));
+    std::vector<std::vector<sum_type>> squares(threads, std::vector<sum_type>(size));
+    std::vector<std::vector<std::size_t>> counts(threads, std::vector<std::size_t>(classes));
+
+    const std::size_t chunk = (n + threads - 1) / threads;
+
+    parallel_for(0, threads, [&](std::size_t t) {
+        sum_type* s  = sums[t].data();
+        sum_type* sq = squares[t].data();
+
+        for (std::size_t i = t * chunk; i < std::min(n, (t + 1) * chunk); ++i) {
+            const std::size_t c = static_cast<std::size_t>(labels[i]);
+
+            // Labels beyond an explicit number of classes are ignored
+            if (c >= classes) {
+                continue;
+            }
+
+            const Pixel* image = images + i * features;
+
+            sum_type* sc  = s + c * features;
+            sum_type* sqc = sq + c * features;
+
+            for (std::size_t j = 0; j < features; ++j) {
+                sum_type v = static_cast<sum_type>(image[j]);
+                sc[j] += v;
+                sqc[j] += v * v;
+            }
+
+            ++counts[t][c];
+        }
+    }, threads);
+
+    centroids.classes  = classes;
+    centroids.features = features;
+    centroids.counts.assign(classes, 0);
+    centroids.means.assign(size, 0.0f);
+    centroids.variances.assign(size, 0.0f);
+    centroids.norms.assign(classes, 0.0f);
+
+    for (std::size_t t = 1; t < threads; ++t) {
+        for (std::size_t k = 0; k < size; ++k) {
+            sums[0][k] += sums[t][k];
+            squares[0][k] += squares[t][k];
+        }
+    }
+
+    for (std::size_t c = 0; c < classes; ++c) {
+        for (std::size_t t = 0; t < threads; ++t) {
+            centroids.counts[c] += counts[t][c];
+        }
+
+        if (!centroids.counts[c]) {
+            continue;
+        }
+
+        const double count = static_cast<double>(centroids.counts[c]);
+
+        for (std::size_t j = 0; j < features; ++j) {
+            double mean     = static_cast<double>(sums[0][c * features + j]) / count;
+            double variance = static_cast<double>(squares[0][c * features + j]) / count - mean * mean;
+
+            centroids.means[c * features + j]     = static_cast<float>(mean);
+            centroids.variances[c * features + j] = static_cast<float>(std::max(variance, 0.0));
+        }
+
+        const float* m     = centroids.means.data() + c * features;
+        centroids.norms[c] = detail::dot(m, m, features);
+    }
+}
+
+/*!
+ * \brief Classify images with the nearest class mean
+ *
+ * The squared distance to each mean is computed as |m|^2 - 2 x.m, the
+ * norm of the image being the same for all the classes. The classes
+ * without any sample are never predicted.
+ *
+ * \param centroids The per-class statistics
+ * \param images The contiguous images (n * centroids.features pixels)
+ * \param n The number of images
+ * \param predictions The output predicted classes (n values)
+ * \param threads The number of threads to use (0: hardware concurrency)
+ */
+template <typename Pixel, typename Label>
+void nearest_centroid(const MNIST_centroids& centroids, const Pixel* images, std::size_t n, Label* predictions, std::size_t threads = 0) {
+    const std::size_t features = centroids.features;
+
+    parallel_for_chunks(0, n, [&](std::size_t begin, std::size_t end) {
+        std::vector<float> image(features);
+
+        for (std::size_t i = begin; i < end; ++i) {
+            detail::to_float(images + i * features, features, image.data());
+
+            std::size_t best = 0;
+            float best_score = std::numeric_limits<float>::max();
+
+            for (std::size_t c = 0; c < centroids.classes; ++c) {
+                if (!centroids.counts[c]) {
+                    continue;
+                }
+
+                float score = centroids.norms[c] - 2.0f * detail::dot(image.data(), centroids.means.data() + c * features, features);
+
+                if (score < best_score) {
+                    best_score = score;
+                    best       = c;
+                }
+            }
+
+            predictions[i] = static_cast<Label>(best);
+        }
+    }, threads);
+}
+
+/*!
+ * \brief Compute the accuracy of the nearest-centroid classifier
+ * \param centroids The per-class statistics
+ * \param images The contiguous images (n * centroids.features pixels)
+ * \param labels The true labels (n labels)
+ * \param n The number of images
+ * \param threads The number of threads to use (0: hardware concurrency)
+ * \return The fraction of images whose nearest centroid is their class
+ */
+template <typename Pixel, typename Label>
+double nearest_centroid_accuracy(const MNIST_centroids& centroids, const Pixel* images, const Label* labels, std::size_t n, std::size_t threads = 0) {
+    if (!n) {
+        return 0.0;
+    }
+
+    std::vector<std::size_t> predictions(n);
+    nearest_centroid(centroids, images, n, predictions.data(), threads);
+
+    std::size_t correct = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        correct += predictions[i] == static_cast<std::size_t>(labels[i]);
+    }
+
+    return static_cast<double>(correct) / n;
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,279 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains CRC32C verification of the dataset files
+ *
+ * The checksum kernels are in mnist_crc32c.hpp. Large buffers are split
+ * into one part per thread and the partial checksums are combined, so that
+ * the verification runs close to the memory bandwidth.
+ *
+ * The expected checksum of a file is stored in a sidecar file next to it
+ * (path + ".crc32c"), which contains the checksum in hexadecimal. The
+ * standard MNIST files can also be verified against their known checksums.
+ */
+
+#ifndef MNIST_CHECKSUM_HPP
+#define MNIST_CHECKSUM_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#include "mnist_crc32c.hpp"
+#include "mnist_mmap.hpp"
+#include "mnist_parallel.hpp"
+
+namespace mnist {
+
+namespace detail {
+
+/*!
+ * \brief Multiply a vector by a matrix over GF(2)
+ */
+inline uint32_t gf2_matrix_times(const uint32_t* mat, uint32_t vec) {
+    uint32_t sum = 0;
+
+    for (; vec; vec >>= 1, ++mat) {
+        if (vec & 1) {
+            sum ^= *mat;
+        }
+    }
+
+    return sum;
+}
+
+/*!
+ * \brief Square a matrix over GF(2)
+ */
+inline void gf2_matrix_square(uint32_t* square, const uint32_t* mat) {
+    for (int n = 0; n < 32; ++n) {
+        square[n] = gf2_matrix_times(mat, mat[n]);
+    }
+}
+
+} //end of namespace detail
+
+/*!
+ * \brief Combine the checksums of two consecutive buffers
+ * \param crc1 The checksum of the first buffer
+ * \param crc2 The checksum of the second buffer
+ * \param n2 The size of the second buffer
+ * \return The checksum of the concatenation of both buffers
+ */
+inline uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, std::size_t n2) {
+    if (!n2) {
+        return crc1;
+    }
+
+    uint32_t even[32]; // operator for an even number of zero bits
+    uint32_t odd[32];  // operator for an odd number of zero bits
+
+    odd[0] = detail::crc32c_polynomial;
+    for (int n = 1; n < 32; ++n) {
+        odd[n] = uint32_t(1) << (n - 1);
+    }
+
+    detail::gf2_matrix_square(even, odd); // 2 zero bits
+    detail::gf2_matrix_square(odd, even); // 4 zero bits
+
+    // Apply n2 zero bytes to crc1
+    do {
+        detail::gf2_matrix_square(even, odd);
+        if (n2 & 1) {
+            crc1 = detail::gf2_matrix_times(even, crc1);
+        }
+        n2 >>= 1;
+
+        if (!n2) {
+            break;
+        }
+
+        detail::gf2_matrix_square(odd, even);
+        if (n2 & 1) {
+            crc1 = detail::gf2_matrix_times(odd, crc1);
+        }
+        n2 >>= 1;
+    } while (n2);
+
+    return crc1 ^ crc2;
+}
+
+/*!
+ * \brief Compute the CRC32C of a buffer with several threads
+ * \param data The buffer
+ * \param n The size of the buffer
+ * \param threads The number of threads to use (0: hardware concurrency)
+ * \return The checksum
+ */
+inline uint32_t crc32c_parallel(const void* data, std::size_t n, std::size_t threads = 0) {
+    constexpr std::size_t min_part = 1024 * 1024;
+
+    if (!threads) {
+        threads = default_threads();
+    }
+
+    std::size_t parts = std::min(threads, n / min_part + 1);
+
+    if (parts <= 1) {
+        return crc32c(data, n);
+    }
+
+    auto p = static_cast<const char*>(data);
+
+    const std::size_t part_size = n / parts;
+
+    std::vector<uint32_t> checksums(parts);
+
+    parallel_for(0, parts, [&](std::size_t i) {
+        std::size_t begin = i * part_size;
+        std::size_t end   = i + 1 == parts ? n : begin + part_size;
+
+        checksums[i] = crc32c(p + begin, end - begin);
+    }, threads);
+
+    uint32_t crc = checksums[0];
+
+    for (std::size_t i = 1; i < parts; ++i) {
+        crc = crc32c_combine(crc, checksums[i], i + 1 == parts ? n - i * part_size : part_size);
+    }
+
+    return crc;
+}
+
+/*!
+ * \brief Compute the CRC32C of a file
+ * \param path The path to the file
+ * \param crc The output checksum
+ * \param threads The number of threads to use (0: hardware concurrency)
+ * \return true on success, false otherwise
+ */
+inline bool file_crc32c(const std::string& path, uint32_t& crc, std::size_t threads = 0) {
+    mapped_file file;
+
+    if (!file.open(path)) {
+        return false;
+    }
+
+    crc = crc32c_parallel(file.data(), file.size(), threads);
+
+    return true;
+}
+
+/*!
+ * \brief Compute the CRC32C of a file and store it in its sidecar file
+ * \param path The path to the file
+ * \param threads The number of threads to use (0: hardware concurrency)
+ * \return true on success, false otherwise
+ */
+inline bool write_crc32c_file(const std::string& path, std::size_t threads = 0) {
+    uint32_t crc = 0;
+
+    if (!file_crc32c(path, crc, threads)) {
+        return false;
+    }
+
+    std::ofstream file(path + ".crc32c", std::ios::out | std::ios::trunc);
+
+    if (!file) {
+        std::cout << "Error opening file" << std::endl;
+        return false;
+    }
+
+    file << std::hex << crc << std::endl;
+
+    return static_cast<bool>(file);
+}
+
+/*!
+ * \brief Verify the CRC32C of a file against a known checksum
+ * \param path The path to the file
+ * \param expected The expected checksum
+ * \param threads The number of threads to use (0: hardware concurrency)
+ * \return true if the file matches the checksum, false otherwise
+ */
+inline bool verify_file_crc32c(const std::string& path, uint32_t expected, std::size_t threads = 0) {
+    uint32_t crc = 0;
+
+    if (!file_crc32c(path, crc, threads)) {
+        return false;
+    }
+
+    if (crc != expected) {
+        std::cout << "Checksum mismatch for " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Verify the CRC32C of a file against its sidecar file
+ * \param path The path to the file
+ * \param threads The number of threads to use (0: hardware concurrency)
+ * \return true if the file matches the checksum, false otherwise
+ */
+inline bool verify_mnist_file(const std::string& path, std::size_t threads = 0) {
+    uint32_t expected = 0;
+
+    if (!read_crc32c_file(path, expected)) {
+        return false;
+    }
+
+    return verify_file_crc32c(path, expected, threads);
+}
+
+/*!
+ * \brief Verify the CRC32C of a standard MNIST file against its known checksum
+ * \param path The path to the file
+ * \param threads The number of threads to use (0: hardware concurrency)
+ * \return true if the file is a standard MNIST file and matches its checksum, false otherwise
+ */
+inline bool verify_known_mnist_file(const std::string& path, std::size_t threads = 0) {
+    mapped_file file;
+
+    if (!file.open(path)) {
+        return false;
+    }
+
+    uint32_t expected = 0;
+
+    if (file.size() < 8 || !known_mnist_crc32c(read_header(file.data(), 0), read_header(file.data(), 1), expected)) {
+        std::cout << "No known checksum for " << path << std::endl;
+        return false;
+    }
+
+    if (crc32c_parallel(file.data(), file.size(), threads) != expected) {
+        std::cout << "Checksum mismatch for " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Verify the four files of the dataset against their sidecar files
+ * \param folder The folder containing the dataset files
+ * \param threads The number of threads to use (0: hardware concurrency)
+ * \return true if all the files match their checksum, false otherwise
+ */
+inline bool verify_mnist_dataset(const std::string& folder, std::size_t threads = 0) {
+    return verify_mnist_file(folder + "/train-images-idx3-ubyte", threads)
+        && verify_mnist_file(folder + "/train-labels-idx1-ubyte", threads)
+        && verify_mnist_file(folder + "/t10k-images-idx3-ubyte", threads)
+        && verify_mnist_file(folder + "/t10k-labels-idx1-ubyte", threads);
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,201 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains an inverted index from labels to sample indices
+ *
+ * The index is built with a counting sort over the labels. The indices of
+ * each class are contiguous and in increasing order, which gives O(1)
+ * access to the samples of a class and O(1) class-conditional sampling.
+ */
+
+#ifndef MNIST_CLASS_INDEX_HPP
+#define MNIST_CLASS_INDEX_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "mnist_random.hpp"
+
+namespace mnist {
+
+constexpr std::size_t no_sample = std::size_t(-1); ///< The sample returned for an empty class
+
+/*!
+ * \brief An inverted index from labels to sample indices
+ */
+struct class_index {
+    std::vector<std::size_t> offsets; ///< The offset of the indices of each class (classes() + 1)
+    std::vector<std::size_t> indices; ///< The sample indices, grouped by class
+
+    /*!
+     * \brief Return the number of classes
+     */
+    std::size_t classes() const {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+
+    /*!
+     * \brief Return the number of samples of the given class
+     */
+    std::size_t count(std::size_t c) const {
+        return offsets[c + 1] - offsets[c];
+    }
+
+    /*!
+     * \brief Return a pointer to the indices of the samples of the given class
+     */
+    const std::size_t* begin(std::size_t c) const {
+        return indices.data() + offsets[c];
+    }
+
+    /*!
+     * \brief Return a pointer past the indices of the samples of the given class
+     */
+    const std::size_t* end(std::size_t c) const {
+        return indices.data() + offsets[c + 1];
+    }
+
+    /*!
+     * \brief Return the indices of the samples of the given classes
+     *
+     * The indices of each class are in increasing order and the classes
+     * are in the given order.
+     *
+     * \param selected The classes to select
+     */
+    std::vector<std::size_t> select(const std::vector<std::size_t>& selected) const {
+        std::size_t n = 0;
+        for (auto c : selected) {
+            n += count(c);
+        }
+
+        std::vector<std::size_t> result;
+        result.reserve(n);
+
+        for (auto c : selected) {
+            result.insert(result.end(), begin(c), end(c));
+        }
+
+        return result;
+    }
+
+    /*!
+     * \brief Return one random sample of the given class
+     * \param c The class
+     * \param rng The generator
+     * \return The index of the sample, no_sample if the class is empty
+     */
+    std::size_t sample(std::size_t c, counter_rng& rng) const {
+        if (c >= classes() || !count(c)) {
+            return no_sample;
+        }
+
+        return indices[offsets[c] + rng.below(static_cast<uint32_t>(count(c)))];
+    }
+
+    /*!
+     * \brief Sample k distinct samples of each class
+     *
+     * Classes with less than k samples contribute all their samples.
+     *
+     * \param k The number of samples per class
+     * \param rng The generator
+     * \return The indices of the samples, grouped by class
+     */
+    std::vector<std::size_t> sample_per_class(std::size_t k, counter_rng rng) const {
+        std::vector<std::size_t> result;
+        result.reserve(k * classes());
+
+        std::vector<std::size_t> pool;
+
+        for (std::size_t c = 0; c < classes(); ++c) {
+            pool.assign(begin(c), end(c));
+
+            std::size_t n = std::min(k, pool.size());
+
+            // Partial Fisher-Yates: the first n elements are a random subset
+            for (std::size_t i = 0; i < n; ++i) {
+                std::size_t j = i + rng.below(static_cast<uint32_t>(pool.size() - i));
+                std::swap(pool[i], pool[j]);
+            }
+
+            result.insert(result.end(), pool.begin(), pool.begin() + n);
+        }
+
+        return result;
+    }
+};
+
+/*!
+ * \brief Build the class index of the given labels
+ *
+ * The samples whose label is not smaller than classes are not indexed.
+ *
+ * \param index The index to build
+ * \param labels The labels
+ * \param n The number of labels
+ * \param classes The number of classes (0: the largest label + 1)
+ */
+template <typename Label>
+void make_class_index(class_index& index, const Label* labels, std::size_t n, std::size_t classes = 0) {
+    if (!classes) {
+        for (std::size_t i = 0; i < n; ++i) {
+            classes = std::max(classes, static_cast<std::size_t>(labels[i]) + 1);
+        }
+    }
+
+    index.offsets.assign(classes + 1, 0);
+
+    // Counting sort
+    for (std::size_t i = 0; i < n; ++i) {
+        auto label = static_cast<std::size_t>(labels[i]);
+
+        if (label < classes) {
+            ++index.offsets[label + 1];
+        }
+    }
+
+    for (std::size_t c = 0; c < classes; ++c) {
+        index.offsets[c + 1] += index.offsets[c];
+    }
+
+    index.indices.resize(index.offsets[classes]);
+
+    std::vector<std::size_t> next(index.offsets.begin(), index.offsets.end() - 1);
+
+    for (std::size_t i = 0; i < n; ++i) {
+        auto label = static_cast<std::size_t>(labels[i]);
+
+        if (label < classes) {
+            index.indices[next[label]++] = i;
+        }
+    }
+}
+
+/*!
+ * \brief Build the class index of the given labels
+ *
+ * The samples whose label is not smaller than classes are not indexed.
+ *
+ * \param labels The labels
+ * \param classes The number of classes (0: the largest label + 1)
+ * \return The class index
+ */
+template <typename Label>
+class_index make_class_index(const std::vector<Label>& labels, std::size_t classes = 0) {
+    class_index index;
+    make_class_index(index, labels.data(), labels.size(), classes);
+    return index;
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,229 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains the CRC32C kernels and the checksums of the MNIST files
+ *
+ * On x86-64, the crc32 instruction of SSE4.2 is used when the processor
+ * supports it, even when the code is not compiled with -msse4.2. Otherwise,
+ * the checksum is computed eight bytes at a time with slicing-by-8 tables.
+ */
+
+#ifndef MNIST_CRC32C_HPP
+#define MNIST_CRC32C_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MNIST_HAS_CRC32C_SSE42
+#include <nmmintrin.h>
+#endif
+
+namespace mnist {
+
+namespace detail {
+
+constexpr uint32_t crc32c_polynomial = 0x82F63B78; ///< The reflected Castagnoli polynomial
+
+/*!
+ * \brief The tables of the slicing-by-8 CRC32C
+ *
+ * table[0] is the classic byte-wise table, table[k] gives the contribution
+ * of a byte followed by k zero bytes.
+ */
+struct crc32c_tables {
+    uint32_t table[8][256]; ///< The tables
+
+    crc32c_tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+
+            for (int k = 0; k < 8; ++k) {
+                c = c & 1 ? (c >> 1) ^ crc32c_polynomial : c >> 1;
+            }
+
+            table[0][i] = c;
+        }
+
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int k = 1; k < 8; ++k) {
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+/*!
+ * \brief Return the tables of the slicing-by-8 CRC32C
+ */
+inline const crc32c_tables& crc32c_table() {
+    static const crc32c_tables tables;
+    return tables;
+}
+
+/*!
+ * \brief Update a (non-inverted) CRC32C with the tables
+ */
+inline uint32_t crc32c_slice8(const unsigned char* p, std::size_t n, uint32_t crc) {
+    const auto& t = crc32c_table().table;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; n >= 8; n -= 8, p += 8) {
+        uint32_t lo;
+        uint32_t hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+
+        lo ^= crc;
+
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+            ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    }
+#endif
+
+    for (; n; --n, ++p) {
+        crc = t[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+#ifdef MNIST_HAS_CRC32C_SSE42
+
+/*!
+ * \brief Update a (non-inverted) CRC32C with the crc32 instruction
+ */
+__attribute__((target("sse4.2"))) inline uint32_t crc32c_sse42(const unsigned char* p, std::size_t n, uint32_t crc) {
+    uint64_t c = crc;
+
+    for (; n >= 8; n -= 8, p += 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        c = _mm_crc32_u64(c, word);
+    }
+
+    crc = static_cast<uint32_t>(c);
+
+    for (; n; --n, ++p) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+
+    return crc;
+}
+
+/*!
+ * \brief Indicates if the processor supports the crc32 instruction
+ */
+inline bool has_crc32c_sse42() {
+#ifdef __SSE4_2__
+    return true;
+#else
+    static const bool supported = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.2") != 0;
+    }();
+
+    return supported;
+#endif
+}
+
+#endif
+
+} //end of namespace detail
+
+/*!
+ * \brief Compute the CRC32C of a buffer
+ * \param data The buffer
+ * \param n The size of the buffer
+ * \param crc The checksum of the preceding data, to compute it incrementally
+ * \return The checksum
+ */
+inline uint32_t crc32c(const void* data, std::size_t n, uint32_t crc = 0) {
+    auto p = static_cast<const unsigned char*>(data);
+
+#ifdef MNIST_HAS_CRC32C_SSE42
+    if (detail::has_crc32c_sse42()) {
+        return ~detail::crc32c_sse42(p, n, ~crc);
+    }
+#endif
+
+    return ~detail::crc32c_slice8(p, n, ~crc);
+}
+
+/*!
+ * \brief Return the CRC32C of a standard (decompressed) MNIST file
+ *
+ * The files are identified by their magic number and their number of
+ * samples. Other datasets in the same format, such as Fashion-MNIST, have
+ * the same header but other checksums, they should be verified with a
+ * sidecar checksum file.
+ *
+ * \param magic The magic number of the file
+ * \param count The number of samples of the file
+ * \param crc The output checksum
+ * \return true if the file is one of the standard files, false otherwise
+ */
+inline bool known_mnist_crc32c(uint32_t magic, std::size_t count, uint32_t& crc) {
+    struct known_file {
+        uint32_t magic;
+        std::size_t count;
+        uint32_t crc;
+    };
+
+    static const known_file files[] = {
+        {0x803, 60000, 0xF09C5EFC}, // train-images-idx3-ubyte
+        {0x801, 60000, 0x469B0E4E}, // train-labels-idx1-ubyte
+        {0x803, 10000, 0x355B09AB}, // t10k-images-idx3-ubyte
+        {0x801, 10000, 0x402A70E0}, // t10k-labels-idx1-ubyte
+    };
+
+    for (auto& file : files) {
+        if (file.magic == magic && file.count == count) {
+            crc = file.crc;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*!
+ * \brief Read the checksum stored in the sidecar file of a file (path + ".crc32c")
+ * \param path The path to the file (not to the sidecar file)
+ * \param crc The output checksum
+ * \param quiet Indicates if a missing sidecar file is not reported
+ * \return true on success, false otherwise
+ */
+inline bool read_crc32c_file(const std::string& path, uint32_t& crc, bool quiet = false) {
+    std::ifstream file(path + ".crc32c");
+
+    if (!file) {
+        if (!quiet) {
+            std::cout << "Error opening file" << std::endl;
+        }
+        return false;
+    }
+
+    file >> std::hex >> crc;
+
+    if (!file) {
+        std::cout << "Invalid checksum file" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,213 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains a read path bypassing the page cache (O_DIRECT)
+ *
+ * Huge one-shot loads read this way do not evict the page cache used by
+ * the other processes of the host.
+ */
+
+#ifndef MNIST_DIRECT_HPP
+#define MNIST_DIRECT_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <memory>
+
+#include "mnist_reader_common.hpp"
+#include "mnist_mmap.hpp"
+
+namespace mnist {
+
+constexpr std::size_t direct_alignment = 4096; ///< The alignment of the offsets, sizes and buffers of direct reads
+
+/*!
+ * \brief Read a MNIST file with O_DIRECT inside a buffer allocated with the given options
+ *
+ * The buffer is page-aligned and its size is rounded up to a multiple of
+ * direct_alignment. When the file system does not support O_DIRECT, at
+ * open or at the first read, the file is read normally and then dropped
+ * from the page cache. On systems without O_DIRECT, this is equivalent to
+ * read_mnist_file.
+ *
+ * \param buffer The buffer to fill
+ * \param path The path to the MNIST file
+ * \param key The expected magic number
+ * \param options The allocation options
+ * \param chunk_size The size of each read (multiple of direct_alignment)
+ * \param verify Indicates if the CRC32C of the file is verified (see verify_mnist_buffer)
+ * \return true on success, false otherwise
+ */
+inline bool read_mnist_file_direct(memory_buffer& buffer, const std::string& path, uint32_t key, const map_options& options = map_options(),
+                                   std::size_t chunk_size = 8 * 1024 * 1024, bool verify = false) {
+#if defined(MNIST_HAS_MMAP) && defined(O_DIRECT)
+    bool direct = true;
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+
+    // Some file systems (tmpfs for instance) do not support O_DIRECT
+    if (fd < 0 && errno == EINVAL) {
+        direct = false;
+        fd     = ::open(path.c_str(), O_RDONLY);
+    }
+
+    if (fd < 0) {
+        std::cout << "Error opening file" << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        std::cout << "Error opening file" << std::endl;
+        return false;
+    }
+
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+
+    if (!buffer.allocate((size + direct_alignment - 1) / direct_alignment * direct_alignment, options)) {
+        ::close(fd);
+        return false;
+    }
+
+    chunk_size = std::max(direct_alignment, chunk_size / direct_alignment * direct_alignment);
+
+    std::size_t done = 0;
+
+    while (done < size) {
+        auto n = ::read(fd, buffer.data() + done, std::min(chunk_size, buffer.size() - done));
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        // Some file systems (FUSE, tmpfs on old kernels) accept O_DIRECT at
+        // open but reject the reads, continue with a buffered read
+        if (n < 0 && errno == EINVAL && direct) {
+            int buffered = ::open(path.c_str(), O_RDONLY);
+
+            if (buffered < 0 || lseek(buffered, static_cast<off_t>(done), SEEK_SET) < 0) {
+                if (buffered >= 0) {
+                    ::close(buffered);
+                }
+                break;
+            }
+
+            ::close(fd);
+
+            fd     = buffered;
+            direct = false;
+
+            continue;
+        }
+
+        if (n <= 0) {
+            break;
+        }
+
+        done += static_cast<std::size_t>(n);
+    }
+
+#ifdef POSIX_FADV_DONTNEED
+    if (!direct) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+#else
+    (void)direct;
+#endif
+
+    ::close(fd);
+
+    if (done < size) {
+        std::cout << "Error reading file" << std::endl;
+        return false;
+    }
+
+    if (!check_mnist_buffer(buffer.data(), size, key)) {
+        return false;
+    }
+
+    return !verify || verify_mnist_buffer(buffer.data(), size, path);
+#else
+    (void)chunk_size;
+
+    if (!read_mnist_file(buffer, path, key, options)) {
+        return false;
+    }
+
+    return !verify || verify_mnist_buffer(buffer.data(), buffer.size(), path);
+#endif
+}
+
+/*!
+ * \brief The content of a MNIST file, read normally or with O_DIRECT
+ */
+struct mnist_file_buffer {
+    std::unique_ptr<char[]> buffer; ///< The content of a normal read
+    memory_buffer aligned;          ///< The content of a direct read
+
+    /*!
+     * \brief Return a pointer to the content of the file
+     */
+    char* get() {
+        return buffer ? buffer.get() : aligned.data();
+    }
+
+    /*!
+     * \brief Return a pointer to the content of the file
+     */
+    const char* get() const {
+        return buffer ? buffer.get() : aligned.data();
+    }
+
+    /*!
+     * \brief Indicates if the file has been read
+     */
+    explicit operator bool() const {
+        return get() != nullptr;
+    }
+};
+
+/*!
+ * \brief Extract the MNIST header from the given buffer
+ * \param buffer The current buffer
+ * \param position The current reading position
+ * \return The value of the mnist header
+ */
+inline uint32_t read_header(const mnist_file_buffer& buffer, size_t position) {
+    return read_header(buffer.get(), position);
+}
+
+/*!
+ * \brief Read a MNIST file inside a raw buffer, with O_DIRECT if asked
+ * \param path The path to the MNIST file
+ * \param key The expected magic number
+ * \param verify Indicates if the CRC32C of the file is verified (see verify_mnist_buffer)
+ * \param direct Indicates if the file is read with O_DIRECT (see read_mnist_file_direct)
+ * \return The buffer, empty on failure
+ */
+inline mnist_file_buffer read_mnist_file(const std::string& path, uint32_t key, bool verify, bool direct) {
+    mnist_file_buffer file;
+
+    if (!direct) {
+        file.buffer = read_mnist_file(path, key, verify);
+    } else if (!read_mnist_file_direct(file.aligned, path, key, map_options(), 8 * 1024 * 1024, verify)) {
+        file.aligned.release();
+    }
+
+    return file;
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,216 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains box downsampling kernels and multi-resolution pyramids
+ */
+
+#ifndef MNIST_DOWNSAMPLE_HPP
+#define MNIST_DOWNSAMPLE_HPP
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "mnist_reader_common.hpp"
+
+namespace mnist {
+
+/*!
+ * \brief Downsample one image by a factor of two with a 2x2 box filter
+ *
+ * Each output pixel is the rounded average of a 2x2 block of input
+ * pixels. When rows or columns is odd, the last row or column is
+ * ignored.
+ *
+ * \param src The input image (rows x columns)
+ * \param rows The number of rows of the input image
+ * \param columns The number of columns of the input image
+ * \param dst The output image (rows / 2 x columns / 2)
+ */
+inline void downsample_2x(const uint8_t* src, std::size_t rows, std::size_t columns, uint8_t* dst) {
+    const std::size_t out_rows    = rows / 2;
+    const std::size_t out_columns = columns / 2;
+
+    for (std::size_t r = 0; r < out_rows; ++r) {
+        const uint8_t* top    = src + (2 * r) * columns;
+        const uint8_t* bottom = top + columns;
+        uint8_t* out          = dst + r * out_columns;
+
+        std::size_t c = 0;
+
+#ifdef __SSE2__
+        const __m128i low_mask = _mm_set1_epi16(0x00FF);
+        const __m128i two      = _mm_set1_epi16(2);
+
+        // 16 input pixels of each row give 8 output pixels
+        for (; c + 8 <= out_columns; c += 8) {
+            __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 2 * c));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 2 * c));
+
+            __m128i sum = _mm_add_epi16(_mm_and_si128(t, low_mask), _mm_srli_epi16(t, 8));
+            sum         = _mm_add_epi16(sum, _mm_and_si128(b, low_mask));
+            sum         = _mm_add_epi16(sum, _mm_srli_epi16(b, 8));
+            sum         = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + c), _mm_packus_epi16(sum, sum));
+        }
+#endif
+
+        for (; c < out_columns; ++c) {
+            unsigned sum = top[2 * c] + top[2 * c + 1] + bottom[2 * c] + bottom[2 * c + 1];
+            out[c]       = static_cast<uint8_t>((sum + 2) >> 2);
+        }
+    }
+}
+
+/*!
+ * \brief Downsample a batch of contiguous images by a factor of two
+ * \param src The input images, stored contiguously
+ * \param count The number of images
+ * \param rows The number of rows of each input image
+ * \param columns The number of columns of each input image
+ * \param dst The output images, stored contiguously
+ */
+inline void downsample_2x_batch(const uint8_t* src, std::size_t count, std::size_t rows, std::size_t columns, uint8_t* dst) {
+    const std::size_t in_size  = rows * columns;
+    const std::size_t out_size = (rows / 2) * (columns / 2);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        downsample_2x(src + i * in_size, rows, columns, dst + i * out_size);
+    }
+}
+
+/*!
+ * \brief A multi-resolution pyramid of images stored in one contiguous buffer
+ *
+ * Each level holds all the images at the same resolution, one after the
+ * other. Level 0 is the full resolution (28x28 for MNIST) and each
+ * following level halves both dimensions (14x14, 7x7, ...).
+ */
+struct MNIST_pyramid {
+    std::vector<uint8_t> buffer;       ///< The pixels of all the levels
+    std::vector<std::size_t> offsets;  ///< The offset of each level inside the buffer
+    std::vector<std::size_t> rows;     ///< The number of rows of each level
+    std::vector<std::size_t> columns;  ///< The number of columns of each level
+    std::size_t count = 0;             ///< The number of images
+
+    /*!
+     * \brief Return the number of levels of the pyramid
+     */
+    std::size_t levels() const {
+        return offsets.size();
+    }
+
+    /*!
+     * \brief Return the number of pixels of one image at the given level
+     */
+    std::size_t image_size(std::size_t level) const {
+        return rows[level] * columns[level];
+    }
+
+    /*!
+     * \brief Return a pointer to the first image of the given level
+     */
+    const uint8_t* level(std::size_t level) const {
+        return buffer.data() + offsets[level];
+    }
+
+    /*!
+     * \brief Return a pointer to the ith image of the given level
+     */
+    const uint8_t* image(std::size_t level, std::size_t i) const {
+        return buffer.data() + offsets[level] + i * image_size(level);
+    }
+};
+
+/*!
+ * \brief Build a pyramid from contiguous images
+ * \param pyramid The pyramid to fill
+ * \param images The contiguous full-resolution images
+ * \param count The number of images
+ * \param rows The number of rows of each image
+ * \param columns The number of columns of each image
+ * \param levels The number of levels, including the full resolution (3 gives 28, 14 and 7 for MNIST)
+ */
+inline void make_pyramid(MNIST_pyramid& pyramid, const uint8_t* images, std::size_t count, std::size_t rows, std::size_t columns, std::size_t levels = 3) {
+    pyramid.count = count;
+    pyramid.offsets.clear();
+    pyramid.rows.clear();
+    pyramid.columns.clear();
+
+    std::size_t total = 0;
+
+    for (std::size_t l = 0; l < levels && rows > 0 && columns > 0; ++l) {
+        pyramid.offsets.push_back(total);
+        pyramid.rows.push_back(rows);
+        pyramid.columns.push_back(columns);
+
+        total += count * rows * columns;
+        rows /= 2;
+        columns /= 2;
+    }
+
+    pyramid.buffer.resize(total);
+
+    if (pyramid.levels() == 0) {
+        return;
+    }
+
+    std::copy(images, images + count * pyramid.image_size(0), pyramid.buffer.begin());
+
+    for (std::size_t l = 1; l < pyramid.levels(); ++l) {
+        downsample_2x_batch(pyramid.buffer.data() + pyramid.offsets[l - 1], count, pyramid.rows[l - 1], pyramid.columns[l - 1],
+                            pyramid.buffer.data() + pyramid.offsets[l]);
+    }
+}
+
+/*!
+ * \brief Read a MNIST image file directly into a multi-resolution pyramid
+ * \param pyramid The pyramid to fill
+ * \param path The path to the image file
+ * \param limit The maximum number of elements to read (0: no limit)
+ * \param levels The number of levels, including the full resolution
+ * \return true on success, false otherwise
+ */
+inline bool read_mnist_pyramid_file(MNIST_pyramid& pyramid, const std::string& path, std::size_t limit = 0, std::size_t levels = 3) {
+    auto buffer = read_mnist_file(path, 0x803);
+
+    if (buffer) {
+        auto count   = read_header(buffer, 1);
+        auto rows    = read_header(buffer, 2);
+        auto columns = read_header(buffer, 3);
+
+        //Skip the header
+        //Cast to unsigned char is necessary cause signedness of char is
+        //platform-specific
+        auto image_buffer = reinterpret_cast<unsigned char*>(buffer.get() + 16);
+
+        if (limit > 0 && count > limit) {
+            count = static_cast<unsigned int>(limit);
+        }
+
+        make_pyramid(pyramid, image_buffer, count, rows, columns, levels);
+
+        return true;
+    } else {
+        return false;
+    }
+}
+
+} //end of namespace mnist
+
+#endif
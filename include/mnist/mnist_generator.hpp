@@ -0,0 +1,342 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains a coroutine API to stream the samples of MNIST files
+ *
+ * The files are read by chunks, the next chunk being read in the
+ * background while the samples of the current one are consumed. The
+ * samples are views inside the chunks, nothing is allocated per sample.
+ *
+ * This header requires C++20 coroutines.
+ */
+
+#ifndef MNIST_GENERATOR_HPP
+#define MNIST_GENERATOR_HPP
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#if !defined(__cpp_impl_coroutine)
+#error "mnist_generator.hpp requires C++20 coroutines"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <utility>
+
+#include "mnist_reader_common.hpp"
+
+namespace mnist {
+
+/*!
+ * \brief A lazy sequence of values produced by a coroutine
+ *
+ * The values are only valid until the generator is advanced.
+ */
+template <typename T>
+class generator {
+public:
+    struct promise_type {
+        const T* value = nullptr;
+
+        generator get_return_object() noexcept {
+            return generator{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always yield_value(const T& v) noexcept {
+            value = std::addressof(v);
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() {
+            throw;
+        }
+    };
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    class iterator {
+    public:
+        explicit iterator(handle_type handle) : handle(handle) {}
+
+        iterator& operator++() {
+            handle.resume();
+            return *this;
+        }
+
+        const T& operator*() const {
+            return *handle.promise().value;
+        }
+
+        const T* operator->() const {
+            return handle.promise().value;
+        }
+
+        bool operator==(std::default_sentinel_t) const {
+            return handle.done();
+        }
+
+    private:
+        handle_type handle;
+    };
+
+    explicit generator(handle_type handle) : handle(handle) {}
+
+    generator(const generator&) = delete;
+    generator& operator=(const generator&) = delete;
+
+    generator(generator&& rhs) noexcept : handle(std::exchange(rhs.handle, nullptr)) {}
+
+    generator& operator=(generator&& rhs) noexcept {
+        if (this != &rhs) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(rhs.handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~generator() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    iterator begin() {
+        handle.resume();
+        return iterator{handle};
+    }
+
+    std::default_sentinel_t end() const noexcept {
+        return {};
+    }
+
+private:
+    handle_type handle;
+};
+
+/*!
+ * \brief A view of one sample
+ */
+struct sample {
+    const uint8_t* image;   ///< The pixels of the image
+    std::size_t image_size; ///< The number of pixels of the image
+    uint8_t label;          ///< The label of the image
+};
+
+/*!
+ * \brief A view of a batch of contiguous samples
+ */
+struct batch {
+    const uint8_t* images;  ///< The pixels of the images
+    const uint8_t* labels;  ///< The labels of the images
+    std::size_t count;      ///< The number of samples of the batch
+    std::size_t image_size; ///< The number of pixels of each image
+};
+
+/*!
+ * \brief Read the records of a MNIST file by chunks, prefetching the next chunk
+ */
+struct chunk_reader {
+    std::ifstream file;           ///< The file
+    std::size_t count       = 0;  ///< The number of records to read
+    std::size_t record_size = 0;  ///< The size of one record
+    std::size_t chunk       = 0;  ///< The number of records of each chunk
+    std::size_t next        = 0;  ///< The next record to read
+
+    std::vector<uint8_t> current; ///< The chunk being consumed
+    std::vector<uint8_t> ahead;   ///< The chunk being prefetched
+    std::future<std::size_t> prefetch;
+
+    /*!
+     * \brief Open the file and check its header
+     * \return true on success, false otherwise
+     */
+    bool open(const std::string& path, uint32_t key, std::size_t limit, std::size_t chunk_records) {
+        file.open(path, std::ios::in | std::ios::binary | std::ios::ate);
+
+        if (!file) {
+            std::cout << "Error opening file" << std::endl;
+            return false;
+        }
+
+        auto size = static_cast<std::size_t>(file.tellg());
+
+        char header[16] = {};
+        std::size_t header_size = key == 0x803 ? 16 : 8;
+
+        file.seekg(0, std::ios::beg);
+        file.read(header, std::min(header_size, size));
+
+        if (!check_mnist_buffer(header, size, key)) {
+            return false;
+        }
+
+        count       = read_header(header, 1);
+        record_size = key == 0x803 ? std::size_t(read_header(header, 2)) * read_header(header, 3) : 1;
+
+        if (limit > 0 && count > limit) {
+            count = limit;
+        }
+
+        chunk = chunk_records ? chunk_records : 1;
+
+        current.resize(chunk * record_size);
+        ahead.resize(chunk * record_size);
+
+        start_prefetch();
+
+        return true;
+    }
+
+    /*!
+     * \brief Wait for the prefetched chunk, make it current and prefetch the next one
+     * \return The number of records of the current chunk, 0 at the end of the file
+     */
+    std::size_t advance() {
+        if (!prefetch.valid()) {
+            return 0;
+        }
+
+        auto n = prefetch.get();
+
+        std::swap(current, ahead);
+
+        if (n) {
+            start_prefetch();
+        }
+
+        return n;
+    }
+
+private:
+    void start_prefetch() {
+        std::size_t n = std::min(chunk, count - next);
+
+        if (!n) {
+            return;
+        }
+
+        next += n;
+
+        prefetch = std::async(std::launch::async, [this, n] {
+            file.read(reinterpret_cast<char*>(ahead.data()), n * record_size);
+            return file ? n : std::size_t(0);
+        });
+    }
+};
+
+/*!
+ * \brief Stream the images of a MNIST image file
+ * \param path The path to the image file
+ * \param limit The maximum number of elements to read (0: no limit)
+ * \param chunk The number of images read at once
+ * \return A generator of pointers to the pixels of each image
+ */
+inline generator<const uint8_t*> stream_mnist_images(std::string path, std::size_t limit = 0, std::size_t chunk = 4096) {
+    chunk_reader images;
+
+    if (!images.open(path, 0x803, limit, chunk)) {
+        co_return;
+    }
+
+    while (auto n = images.advance()) {
+        for (std::size_t i = 0; i < n; ++i) {
+            co_yield images.current.data() + i * images.record_size;
+        }
+    }
+}
+
+/*!
+ * \brief Stream the samples of a pair of MNIST image and label files
+ * \param images_path The path to the image file
+ * \param labels_path The path to the label file
+ * \param limit The maximum number of elements to read (0: no limit)
+ * \param chunk The number of samples read at once
+ * \return A generator of samples
+ */
+inline generator<sample> stream_mnist(std::string images_path, std::string labels_path, std::size_t limit = 0, std::size_t chunk = 4096) {
+    chunk_reader images;
+    chunk_reader labels;
+
+    if (!images.open(images_path, 0x803, limit, chunk) || !labels.open(labels_path, 0x801, limit, chunk)) {
+        co_return;
+    }
+
+    while (true) {
+        auto n = images.advance();
+
+        if (labels.advance() != n || !n) {
+            co_return;
+        }
+
+        for (std::size_t i = 0; i < n; ++i) {
+            co_yield sample{images.current.data() + i * images.record_size, images.record_size, labels.current[i]};
+        }
+    }
+}
+
+/*!
+ * \brief Stream batches of samples of a pair of MNIST image and label files
+ *
+ * All the batches contain batch_size samples, except maybe the last one.
+ *
+ * \param images_path The path to the image file
+ * \param labels_path The path to the label file
+ * \param batch_size The number of samples of each batch
+ * \param limit The maximum number of elements to read (0: no limit)
+ * \param batches_per_chunk The number of batches read at once
+ * \return A generator of batches
+ */
+inline generator<batch> stream_mnist_batches(std::string images_path, std::string labels_path, std::size_t batch_size, std::size_t limit = 0,
+                                             std::size_t batches_per_chunk = 32) {
+    chunk_reader images;
+    chunk_reader labels;
+
+    batch_size = batch_size ? batch_size : 1;
+
+    const std::size_t chunk = batch_size * (batches_per_chunk ? batches_per_chunk : 1);
+
+    if (!images.open(images_path, 0x803, limit, chunk) || !labels.open(labels_path, 0x801, limit, chunk)) {
+        co_return;
+    }
+
+    while (true) {
+        auto n = images.advance();
+
+        if (labels.advance() != n || !n) {
+            co_return;
+        }
+
+        for (std::size_t i = 0; i < n; i += batch_size) {
+            co_yield batch{images.current.data() + i * images.record_size, labels.current.data() + i, std::min(batch_size, n - i), images.record_size};
+        }
+    }
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,332 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains Histogram of Oriented Gradients (HOG) features
+ *
+ * The gradients are computed with centered differences, their unsigned
+ * orientations are voted into the histograms of the cells with linear
+ * interpolation between the two closest bins, and the histograms of each
+ * block of cells are normalized with L2-Hys.
+ *
+ * The magnitude and the orientation of the gradients are computed four
+ * pixels at a time with SSE2, the orientation with a branchless polynomial
+ * arctangent. The images of a batch are processed in parallel.
+ */
+
+#ifndef MNIST_HOG_HPP
+#define MNIST_HOG_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#include "mnist_reader_common.hpp"
+#include "mnist_parallel.hpp"
+#include "mnist_simd.hpp"
+
+namespace mnist {
+
+/*!
+ * \brief The parameters of the HOG features
+ */
+struct hog_options {
+    std::size_t cell_size  = 4; ///< The size of a cell, in pixels
+    std::size_t bins       = 9; ///< The number of orientation bins over [0, pi)
+    std::size_t block_size = 2; ///< The size of a block, in cells (blocks overlap with a stride of one cell)
+};
+
+/*!
+ * \brief Return the number of HOG features of one image
+ * \param rows The number of rows of the image
+ * \param columns The number of columns of the image
+ * \param options The parameters of the features
+ */
+inline std::size_t hog_size(std::size_t rows, std::size_t columns, const hog_options& options = hog_options()) {
+    const std::size_t cell_rows    = rows / options.cell_size;
+    const std::size_t cell_columns = columns / options.cell_size;
+
+    if (cell_rows < options.block_size || cell_columns < options.block_size) {
+        return 0;
+    }
+
+    return (cell_rows - options.block_size + 1) * (cell_columns - options.block_size + 1) * options.block_size * options.block_size * options.bins;
+}
+
+namespace detail {
+
+/*!
+ * \brief The temporary buffers of the HOG of one image
+ */
+struct hog_scratch {
+    std::vector<float> pixels;    ///< The image in float
+    std::vector<float> magnitude; ///< The magnitude of the gradients
+    std::vector<float> position;  ///< The continuous bin position of the gradients
+    std::vector<float> cells;     ///< The histograms of the cells
+};
+
+/*!
+ * \brief Compute the unsigned orientation of (x, y), in [0, pi]
+ *
+ * Polynomial approximation, with a maximum error of about 2e-4 radians.
+ */
+inline float unsigned_orientation(float x, float y) {
+    const float pi = 3.14159265358979f;
+
+    // Fold the half-plane y < 0 onto y >= 0
+    x = y < 0.0f ? -x : x;
+    y = y < 0.0f ? -y : y;
+
+    const float ax = std::abs(x);
+    const float mn = std::min(ax, y);
+    const float mx = std::max(ax, y);
+
+    const float a = mn / (mx + 1e-20f);
+    const float s = a * a;
+
+    float r = ((-0.0464964749f * s + 0.15931422f) * s - 0.327622764f) * s * a + a;
+
+    r = y > ax ? 0.5f * pi - r : r;
+    r = x < 0.0f ? pi - r : r;
+
+    return r;
+}
+
+/*!
+ * \brief Convert the gradients (gx, gy) in place to their magnitude and bin position
+ */
+inline void gradient_polar(float* gx, float* gy, std::size_t n, float bin_scale) {
+    std::size_t j = 0;
+
+#ifdef __SSE2__
+    const __m128 zero    = _mm_setzero_ps();
+    const __m128 sign    = _mm_set1_ps(-0.0f);
+    const __m128 pi      = _mm_set1_ps(3.14159265358979f);
+    const __m128 half_pi = _mm_set1_ps(0.5f * 3.14159265358979f);
+    const __m128 tiny    = _mm_set1_ps(1e-20f);
+    const __m128 c0      = _mm_set1_ps(-0.0464964749f);
+    const __m128 c1      = _mm_set1_ps(0.15931422f);
+    const __m128 c2      = _mm_set1_ps(-0.327622764f);
+    const __m128 scale   = _mm_set1_ps(bin_scale);
+    const __m128 half    = _mm_set1_ps(0.5f);
+
+    for (; j + 4 <= n; j += 4) {
+        __m128 x = _mm_loadu_ps(gx + j);
+        __m128 y = _mm_loadu_ps(gy + j);
+
+        _mm_storeu_ps(gx + j, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y))));
+
+        // Fold the half-plane y < 0 onto y >= 0 by flipping both signs
+        __m128 flip = _mm_and_ps(_mm_cmplt_ps(y, zero), sign);
+        x           = _mm_xor_ps(x, flip);
+        y           = _mm_xor_ps(y, flip);
+
+        __m128 ax = _mm_andnot_ps(sign, x);
+        __m128 a  = _mm_div_ps(_mm_min_ps(ax, y), _mm_add_ps(_mm_max_ps(ax, y), tiny));
+        __m128 s  = _mm_mul_ps(a, a);
+
+        __m128 p = _mm_add_ps(_mm_mul_ps(c0, s), c1);
+        p        = _mm_add_ps(_mm_mul_ps(p, s), c2);
+        __m128 r = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, s), a), a);
+
+        __m128 steep = _mm_cmpgt_ps(y, ax);
+        r            = _mm_or_ps(_mm_and_ps(steep, _mm_sub_ps(half_pi, r)), _mm_andnot_ps(steep, r));
+
+        __m128 left = _mm_cmplt_ps(x, zero);
+        r           = _mm_or_ps(_mm_and_ps(left, _mm_sub_ps(pi, r)), _mm_andnot_ps(left, r));
+
+        _mm_storeu_ps(gy + j, _mm_sub_ps(_mm_mul_ps(r, scale), half));
+    }
+#endif
+
+    for (; j < n; ++j) {
+        const float x = gx[j];
+        const float y = gy[j];
+
+        gx[j] = std::sqrt(x * x + y * y);
+        gy[j] = unsigned_orientation(x, y) * bin_scale - 0.5f;
+    }
+}
+
+/*!
+ * \brief Compute the HOG features of one image
+ */
+template <typename Pixel>
+void hog_image(const Pixel* image, std::size_t rows, std::size_t columns, const hog_options& options, hog_scratch& scratch, float* out) {
+    const std::size_t size = rows * columns;
+    const std::size_t bins = options.bins;
+
+    const float bin_scale = static_cast<float>(bins) / 3.14159265358979f;
+
+    scratch.pixels.resize(size);
+    scratch.magnitude.resize(size);
+    scratch.position.resize(size);
+
+    float* pixels    = scratch.pixels.data();
+    float* magnitude = scratch.magnitude.data();
+    float* position  = scratch.position.data();
+
+    to_float(image, size, pixels);
+
+    // Gradients, with one-sided differences on the borders, gx is stored
+    // in magnitude and gy in position
+    for (std::size_t r = 0; r < rows; ++r) {
+        const float* row  = pixels + r * columns;
+        const float* up   = pixels + (r > 0 ? r - 1 : r) * columns;
+        const float* down = pixels + (r + 1 < rows ? r + 1 : r) * columns;
+
+        float* gx = magnitude + r * columns;
+        float* gy = position + r * columns;
+
+        for (std::size_t c = 1; c + 1 < columns; ++c) {
+            gx[c] = row[c + 1] - row[c - 1];
+        }
+
+        gx[0]           = row[columns > 1 ? 1 : 0] - row[0];
+        gx[columns - 1] = row[columns - 1] - row[columns > 1 ? columns - 2 : 0];
+
+        for (std::size_t c = 0; c < columns; ++c) {
+            gy[c] = down[c] - up[c];
+        }
+    }
+
+    gradient_polar(magnitude, position, size, bin_scale);
+
+    const std::size_t cell_rows    = rows / options.cell_size;
+    const std::size_t cell_columns = columns / options.cell_size;
+
+    scratch.cells.assign(cell_rows * cell_columns * bins, 0.0f);
+
+    // Vote into the histograms of the cells
+    for (std::size_t r = 0; r < cell_rows * options.cell_size; ++r) {
+        float* cell_row = scratch.cells.data() + (r / options.cell_size) * cell_columns * bins;
+
+        for (std::size_t c = 0; c < cell_columns * options.cell_size; ++c) {
+            const float p = position[r * columns + c];
+            const float m = magnitude[r * columns + c];
+
+            const float lower = std::floor(p);
+            const float frac  = p - lower;
+
+            // position is in [-0.5, bins - 0.5], the bins wrap around
+            const std::size_t b0 = lower < 0.0f ? bins - 1 : static_cast<std::size_t>(lower);
+            const std::size_t b1 = b0 + 1 == bins ? 0 : b0 + 1;
+
+            float* hist = cell_row + (c / options.cell_size) * bins;
+
+            hist[b0] += m * (1.0f - frac);
+            hist[b1] += m * frac;
+        }
+    }
+
+    // Normalize the blocks with L2-Hys
+    const std::size_t block_values = options.block_size * options.block_size * bins;
+
+    for (std::size_t br = 0; br + options.block_size <= cell_rows; ++br) {
+        for (std::size_t bc = 0; bc + options.block_size <= cell_columns; ++bc) {
+            float* block = out;
+
+            for (std::size_t i = 0; i < options.block_size; ++i) {
+                const float* cell = scratch.cells.data() + ((br + i) * cell_columns + bc) * bins;
+                out = std::copy(cell, cell + options.block_size * bins, out);
+            }
+
+            for (int pass = 0; pass < 2; ++pass) {
+                float norm = 0.0f;
+                for (std::size_t k = 0; k < block_values; ++k) {
+                    norm += block[k] * block[k];
+                }
+
+                const float inverse = 1.0f / std::sqrt(norm + 1e-6f);
+
+                for (std::size_t k = 0; k < block_values; ++k) {
+                    block[k] = pass == 0 ? std::min(block[k] * inverse, 0.2f) : block[k] * inverse;
+                }
+            }
+        }
+    }
+}
+
+} //end of namespace detail
+
+/*!
+ * \brief Compute the HOG features of a batch of images
+ * \param images The contiguous images (n * rows * columns pixels)
+ * \param n The number of images
+ * \param rows The number of rows of each image
+ * \param columns The number of columns of each image
+ * \param out The output features (n * hog_size(rows, columns, options) values)
+ * \param options The parameters of the features
+ * \param threads The number of threads to use (0: hardware concurrency)
+ */
+template <typename Pixel>
+void hog_batch(const Pixel* images, std::size_t n, std::size_t rows, std::size_t columns, float* out, const hog_options& options = hog_options(), std::size_t threads = 0) {
+    const std::size_t features = hog_size(rows, columns, options);
+
+    if (!features) {
+        return;
+    }
+
+    parallel_for_chunks(0, n, [&](std::size_t begin, std::size_t end) {
+        detail::hog_scratch scratch;
+
+        for (std::size_t i = begin; i < end; ++i) {
+            detail::hog_image(images + i * rows * columns, rows, columns, options, scratch, out + i * features);
+        }
+    }, threads);
+}
+
+/*!
+ * \brief Read a MNIST image file and compute the HOG features of its images
+ * \param path The path to the image file
+ * \param features The output feature matrix (count * feature_size values)
+ * \param feature_size The output number of features of each image
+ * \param limit The maximum number of images to read (0: no limit)
+ * \param options The parameters of the features
+ * \param threads The number of threads to use (0: hardware concurrency)
+ * \return true on success, false otherwise
+ */
+inline bool read_mnist_hog_file(const std::string& path, std::vector<float>& features, std::size_t& feature_size, std::size_t limit = 0,
+                                const hog_options& options = hog_options(), std::size_t threads = 0) {
+    auto buffer = read_mnist_file(path, 0x803);
+
+    if (buffer) {
+        std::size_t count = read_header(buffer, 1);
+        auto rows         = read_header(buffer, 2);
+        auto columns      = read_header(buffer, 3);
+
+        if (limit > 0 && count > limit) {
+            count = limit;
+        }
+
+        feature_size = hog_size(rows, columns, options);
+
+        if (!feature_size) {
+            std::cout << "The images are too small for the HOG parameters" << std::endl;
+            return false;
+        }
+
+        auto image_buffer = reinterpret_cast<const uint8_t*>(buffer.get() + 16);
+
+        features.resize(count * feature_size);
+        hog_batch(image_buffer, count, rows, columns, features.data(), options, threads);
+
+        return true;
+    } else {
+        return false;
+    }
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,401 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains integral images (summed-area tables) and Haar-like features
+ *
+ * The integral image of a rows x columns image has (rows + 1) x (columns + 1)
+ * int32 values (29 x 29 for a digit), the first row and the first column
+ * being zero, so that the sum of any rectangle is obtained with four
+ * lookups.
+ *
+ * Each row is computed as the prefix sum of the pixels of the row, four
+ * pixels at a time with SSE2, added to the previous row of the table.
+ */
+
+#ifndef MNIST_INTEGRAL_HPP
+#define MNIST_INTEGRAL_HPP
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "mnist_reader_common.hpp"
+#include "mnist_parallel.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace mnist {
+
+/*!
+ * \brief Return the number of values of the integral image of one image
+ * \param rows The number of rows of the image
+ * \param columns The number of columns of the image
+ */
+inline std::size_t integral_size(std::size_t rows, std::size_t columns) {
+    return (rows + 1) * (columns + 1);
+}
+
+/*!
+ * \brief Compute the integral image of one image
+ * \param image The image (rows * columns integral pixels)
+ * \param rows The number of rows of the image
+ * \param columns The number of columns of the image
+ * \param out The output integral image (integral_size(rows, columns) values)
+ */
+template <typename Pixel>
+void integral_image(const Pixel* image, std::size_t rows, std::size_t columns, int32_t* out) {
+    const std::size_t stride = columns + 1;
+
+    std::memset(out, 0, stride * sizeof(int32_t));
+
+    for (std::size_t r = 0; r < rows; ++r) {
+        const Pixel* row    = image + r * columns;
+        const int32_t* prev = out + r * stride;
+        int32_t* current    = out + (r + 1) * stride;
+
+        int32_t sum = 0;
+        current[0]  = 0;
+
+        for (std::size_t c = 0; c < columns; ++c) {
+            sum += static_cast<int32_t>(row[c]);
+            current[c + 1] = prev[c + 1] + sum;
+        }
+    }
+}
+
+/*!
+ * \brief Compute the integral image of one 8-bit image
+ * \param image The image (rows * columns pixels)
+ * \param rows The number of rows of the image
+ * \param columns The number of columns of the image
+ * \param out The output integral image (integral_size(rows, columns) values)
+ */
+inline void integral_image(const uint8_t* image, std::size_t rows, std::size_t columns, int32_t* out) {
+    const std::size_t stride = columns + 1;
+
+    std::memset(out, 0, stride * sizeof(int32_t));
+
+    for (std::size_t r = 0; r < rows; ++r) {
+        const uint8_t* row  = image + r * columns;
+        const int32_t* prev = out + r * stride;
+        int32_t* current    = out + (r + 1) * stride;
+
+        std::size_t c = 0;
+        int32_t sum   = 0;
+        current[0]    = 0;
+
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+
+        __m128i carry = _mm_setzero_si128();
+
+        for (; c + 4 <= columns; c += 4) {
+            int32_t packed;
+            std::memcpy(&packed, row + c, sizeof(packed));
+
+            __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+
+            // Prefix sum of the four lanes
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+            v = _mm_add_epi32(v, carry);
+
+            carry = _mm_shuffle_epi32(v, 0xFF);
+
+            __m128i above = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + c + 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(current + c + 1), _mm_add_epi32(v, above));
+        }
+
+        sum = _mm_cvtsi128_si32(carry);
+#endif
+
+        for (; c < columns; ++c) {
+            sum += row[c];
+            current[c + 1] = prev[c + 1] + sum;
+        }
+    }
+}
+
+/*!
+ * \brief Compute the integral images of a batch of images
+ * \param images The contiguous images (n * rows * columns pixels)
+ * \param n The number of images
+ * \param rows The number of rows of each image
+ * \param columns The number of columns of each image
+ * \param out The output integral images (n * integral_size(rows, columns) values)
+ * \param threads The number of threads to use (0: hardware concurrency)
+ */
+template <typename Pixel>
+void integral_batch(const Pixel* images, std::size_t n, std::size_t rows, std::size_t columns, int32_t* out, std::size_t threads = 0) {
+    const std::size_t size = integral_size(rows, columns);
+
+    parallel_for_chunks(0, n, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            integral_image(images + i * rows * columns, rows, columns, out + i * size);
+        }
+    }, threads);
+}
+
+/*!
+ * \brief Read a MNIST image file and compute the integral images of its images
+ * \param path The path to the image file
+ * \param integrals The output integral images (count * integral_size(rows, columns) values)
+ * \param rows The output number of rows of each image
+ * \param columns The output number of columns of each image
+ * \param limit The maximum number of images to read (0: no limit)
+ * \param threads The number of threads to use (0: hardware concurrency)
+ * \return true on success, false otherwise
+ */
+inline bool read_mnist_integral_file(const std::string& path, std::vector<int32_t>& integrals, std::size_t& rows, std::size_t& columns, std::size_t limit = 0, std::size_t threads = 0) {
+    auto buffer = read_mnist_file(path, 0x803);
+
+    if (buffer) {
+        std::size_t count = read_header(buffer, 1);
+        rows              = read_header(buffer, 2);
+        columns           = read_header(buffer, 3);
+
+        if (limit > 0 && count > limit) {
+            count = limit;
+        }
+
+        auto image_buffer = reinterpret_cast<const uint8_t*>(buffer.get() + 16);
+
+        integrals.resize(count * integral_size(rows, columns));
+        integral_batch(image_buffer, count, rows, columns, integrals.data(), threads);
+
+        return true;
+    } else {
+        return false;
+    }
+}
+
+/*!
+ * \brief Compute the sum of a rectangle of an image from its integral image
+ * \param integral The integral image
+ * \param stride The number of values of a row of the integral image (columns + 1)
+ * \param r0 The first row of the rectangle
+ * \param c0 The first column of the rectangle
+ * \param r1 The end row of the rectangle (exclusive)
+ * \param c1 The end column of the rectangle (exclusive)
+ * \return The sum of the pixels of the rectangle
+ */
+inline int32_t rect_sum(const int32_t* integral, std::size_t stride, std::size_t r0, std::size_t c0, std::size_t r1, std::size_t c1) {
+    return integral[r1 * stride + c1] - integral[r0 * stride + c1] - integral[r1 * stride + c0] + integral[r0 * stride + c0];
+}
+
+/*!
+ * \brief The kinds of Haar-like features
+ */
+enum class haar_type : uint8_t {
+    edge_horizontal, ///< Left half minus right half
+    edge_vertical,   ///< Top half minus bottom half
+    line_horizontal, ///< Middle third minus the left and right thirds
+    line_vertical,   ///< Middle third minus the top and bottom thirds
+    four             ///< Top-left and bottom-right quarters minus the other two
+};
+
+/*!
+ * \brief A Haar-like feature
+ *
+ * The height must be even for edge_vertical and four and a multiple of
+ * three for line_vertical, and likewise for the width.
+ */
+struct haar_feature {
+    haar_type type; ///< The kind of feature
+    uint8_t row;    ///< The first row of the feature
+    uint8_t column; ///< The first column of the feature
+    uint8_t height; ///< The total height of the feature
+    uint8_t width;  ///< The total width of the feature
+};
+
+namespace detail {
+
+/*!
+ * \brief A Haar-like feature compiled to weighted corners of the integral image
+ *
+ * The rectangles of a feature share corners, a feature needs at most
+ * nine lookups.
+ */
+struct haar_terms {
+    std::size_t count = 0;  ///< The number of corners
+    std::size_t offsets[9]; ///< The offsets of the corners in the integral image
+    int32_t weights[9];     ///< The weights of the corners
+
+    void add(std::size_t offset, int32_t weight) {
+        for (std::size_t k = 0; k < count; ++k) {
+            if (offsets[k] == offset) {
+                weights[k] += weight;
+                return;
+            }
+        }
+
+        offsets[count] = offset;
+        weights[count] = weight;
+        ++count;
+    }
+
+    void rect(std::size_t stride, std::size_t r0, std::size_t c0, std::size_t r1, std::size_t c1, int32_t weight) {
+        add(r1 * stride + c1, weight);
+        add(r0 * stride + c1, -weight);
+        add(r1 * stride + c0, -weight);
+        add(r0 * stride + c0, weight);
+    }
+};
+
+/*!
+ * \brief Compile a Haar-like feature for integral images with the given stride
+ */
+inline haar_terms compile_haar(const haar_feature& feature, std::size_t stride) {
+    haar_terms terms;
+
+    const std::size_t r = feature.row;
+    const std::size_t c = feature.column;
+    const std::size_t h = feature.height;
+    const std::size_t w = feature.width;
+
+    switch (feature.type) {
+        case haar_type::edge_horizontal:
+            terms.rect(stride, r, c, r + h, c + w / 2, 1);
+            terms.rect(stride, r, c + w / 2, r + h, c + w, -1);
+            break;
+        case haar_type::edge_vertical:
+            terms.rect(stride, r, c, r + h / 2, c + w, 1);
+            terms.rect(stride, r + h / 2, c, r + h, c + w, -1);
+            break;
+        case haar_type::line_horizontal:
+            terms.rect(stride, r, c, r + h, c + w, -1);
+            terms.rect(stride, r, c + w / 3, r + h, c + 2 * w / 3, 2);
+            break;
+        case haar_type::line_vertical:
+            terms.rect(stride, r, c, r + h, c + w, -1);
+            terms.rect(stride, r + h / 3, c, r + 2 * h / 3, c + w, 2);
+            break;
+        case haar_type::four:
+            terms.rect(stride, r, c, r + h / 2, c + w / 2, 1);
+            terms.rect(stride, r, c + w / 2, r + h / 2, c + w, -1);
+            terms.rect(stride, r + h / 2, c, r + h, c + w / 2, -1);
+            terms.rect(stride, r + h / 2, c + w / 2, r + h, c + w, 1);
+            break;
+    }
+
+    // Drop the corners that cancel out
+    std::size_t kept = 0;
+    for (std::size_t k = 0; k < terms.count; ++k) {
+        if (terms.weights[k]) {
+            terms.offsets[kept] = terms.offsets[k];
+            terms.weights[kept] = terms.weights[k];
+            ++kept;
+        }
+    }
+
+    terms.count = kept;
+
+    return terms;
+}
+
+} //end of namespace detail
+
+/*!
+ * \brief Compute the value of a Haar-like feature from an integral image
+ * \param integral The integral image
+ * \param stride The number of values of a row of the integral image (columns + 1)
+ * \param feature The feature
+ * \return The value of the feature
+ */
+inline int32_t haar_value(const int32_t* integral, std::size_t stride, const haar_feature& feature) {
+    auto terms = detail::compile_haar(feature, stride);
+
+    int32_t value = 0;
+    for (std::size_t k = 0; k < terms.count; ++k) {
+        value += terms.weights[k] * integral[terms.offsets[k]];
+    }
+
+    return value;
+}
+
+/*!
+ * \brief Compute the value of a Haar-like feature for a batch of integral images
+ *
+ * This is the access pattern of the training of decision stumps: one
+ * feature over all the samples.
+ *
+ * \param integrals The contiguous integral images (n * integral_size(rows, columns) values)
+ * \param n The number of integral images
+ * \param rows The number of rows of the images
+ * \param columns The number of columns of the images
+ * \param feature The feature
+ * \param out The output values (n values)
+ * \param threads The number of threads to use (0: hardware concurrency)
+ */
+inline void haar_batch(const int32_t* integrals, std::size_t n, std::size_t rows, std::size_t columns, const haar_feature& feature, int32_t* out, std::size_t threads = 0) {
+    const std::size_t size = integral_size(rows, columns);
+    const auto terms       = detail::compile_haar(feature, columns + 1);
+
+    parallel_for_chunks(0, n, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const int32_t* integral = integrals + i * size;
+
+            int32_t value = 0;
+            for (std::size_t k = 0; k < terms.count; ++k) {
+                value += terms.weights[k] * integral[terms.offsets[k]];
+            }
+
+            out[i] = value;
+        }
+    }, threads);
+}
+
+/*!
+ * \brief Enumerate the Haar-like features that fit in an image
+ * \param rows The number of rows of the images (at most 255)
+ * \param columns The number of columns of the images (at most 255)
+ * \param step The step between the positions and between the sizes of the features
+ * \return A std::vector with all the valid features, empty if the images are too large
+ */
+inline std::vector<haar_feature> make_haar_features(std::size_t rows, std::size_t columns, std::size_t step = 1) {
+    std::vector<haar_feature> features;
+
+    // The positions and sizes of the features are stored on 8 bits
+    if (rows > 255 || columns > 255) {
+        std::cout << "The images are too large for Haar-like features (at most 255x255)" << std::endl;
+        return features;
+    }
+
+    if (!step) {
+        step = 1;
+    }
+
+    const haar_type types[]          = {haar_type::edge_horizontal, haar_type::edge_vertical, haar_type::line_horizontal, haar_type::line_vertical, haar_type::four};
+    const std::size_t row_units[]    = {1, 2, 1, 3, 2};
+    const std::size_t column_units[] = {2, 1, 3, 1, 2};
+
+    for (std::size_t t = 0; t < 5; ++t) {
+        for (std::size_t h = row_units[t]; h <= rows; h += row_units[t] * step) {
+            for (std::size_t w = column_units[t]; w <= columns; w += column_units[t] * step) {
+                for (std::size_t r = 0; r + h <= rows; r += step) {
+                    for (std::size_t c = 0; c + w <= columns; c += step) {
+                        features.push_back({types[t], static_cast<uint8_t>(r), static_cast<uint8_t>(c), static_cast<uint8_t>(h), static_cast<uint8_t>(w)});
+                    }
+                }
+            }
+        }
+    }
+
+    return features;
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,310 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains an epoch-based batch loader whose state can be checkpointed
+ *
+ * The loader produces shuffled batches of sample indices, epoch after
+ * epoch. Its complete state (seed, epoch and position in the epoch) can be
+ * saved and restored, so that a preempted job resumes exactly where it
+ * stopped. The shuffling and the augmentation use the counter-based
+ * generator of mnist_random.hpp, so no generator state needs to be saved.
+ */
+
+#ifndef MNIST_LOADER_HPP
+#define MNIST_LOADER_HPP
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "mnist_random.hpp"
+
+namespace mnist {
+
+/*!
+ * \brief The complete state of a batch loader
+ *
+ * The dataset size, the batch size and the shuffling flag are saved along
+ * the position so that a state is never restored into a loader iterating
+ * differently.
+ */
+struct loader_state {
+    uint64_t seed       = 0;    ///< The seed of the loader
+    uint64_t epoch      = 0;    ///< The current epoch
+    uint64_t position   = 0;    ///< The position inside the current epoch
+    uint64_t count      = 0;    ///< The number of samples of the loader
+    uint64_t batch_size = 0;    ///< The number of samples of each batch
+    bool shuffle        = true; ///< Indicates if the samples are shuffled
+};
+
+/*!
+ * \brief Save a loader state to a file
+ *
+ * The state is first written to a temporary file, flushed to the disk and
+ * then renamed over the previous checkpoint, so that a crash during the
+ * save always leaves either the old or the new checkpoint.
+ *
+ * \param state The state to save
+ * \param path The path to the file
+ * \return true on success, false otherwise
+ */
+inline bool save_loader_state(const loader_state& state, const std::string& path) {
+    const std::string tmp = path + ".tmp";
+
+    std::FILE* file = std::fopen(tmp.c_str(), "w");
+
+    if (!file) {
+        std::cout << "Error opening file" << std::endl;
+        return false;
+    }
+
+    bool ok = std::fprintf(file, "mnist_loader 1\nseed %llu\nepoch %llu\nposition %llu\ncount %llu\nbatch_size %llu\nshuffle %d\n",
+                           static_cast<unsigned long long>(state.seed), static_cast<unsigned long long>(state.epoch),
+                           static_cast<unsigned long long>(state.position), static_cast<unsigned long long>(state.count),
+                           static_cast<unsigned long long>(state.batch_size), state.shuffle ? 1 : 0) > 0;
+
+    ok = std::fflush(file) == 0 && ok;
+
+#if defined(__unix__) || defined(__APPLE__)
+    // The rename must not reach the disk before the content of the file
+    ok = ::fsync(fileno(file)) == 0 && ok;
+#endif
+
+    ok = std::fclose(file) == 0 && ok;
+
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cout << "Error writing file" << std::endl;
+        std::remove(tmp.c_str());
+        return false;
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    // Make the rename itself durable
+    auto slash            = path.find_last_of('/');
+    const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+
+    int fd = ::open(dir.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#endif
+
+    return true;
+}
+
+/*!
+ * \brief Load a loader state from a file
+ * \param state The state to fill
+ * \param path The path to the file
+ * \return true on success, false otherwise
+ */
+inline bool load_loader_state(loader_state& state, const std::string& path) {
+    std::ifstream file(path);
+
+    if (!file) {
+        std::cout << "Error opening file" << std::endl;
+        return false;
+    }
+
+    std::string magic;
+    int version = 0;
+
+    file >> magic >> version;
+
+    if (magic != "mnist_loader" || version != 1) {
+        std::cout << "Invalid loader state file" << std::endl;
+        return false;
+    }
+
+    std::string keys[6];
+    int shuffle = 0;
+
+    file >> keys[0] >> state.seed >> keys[1] >> state.epoch >> keys[2] >> state.position;
+    file >> keys[3] >> state.count >> keys[4] >> state.batch_size >> keys[5] >> shuffle;
+
+    if (!file || keys[0] != "seed" || keys[1] != "epoch" || keys[2] != "position" || keys[3] != "count" || keys[4] != "batch_size"
+        || keys[5] != "shuffle") {
+        std::cout << "Invalid loader state file" << std::endl;
+        return false;
+    }
+
+    state.shuffle = shuffle != 0;
+
+    return true;
+}
+
+/*!
+ * \brief An epoch-based loader of shuffled batches of sample indices
+ *
+ * The permutation of each epoch only depends on the seed and the epoch,
+ * so it is recomputed on restore rather than stored. Likewise, the
+ * generator of each sample only depends on the seed, the epoch and the
+ * index of the sample.
+ */
+struct batch_loader {
+    /*!
+     * \brief Construct a loader
+     * \param count The number of samples of the dataset
+     * \param batch_size The number of samples of each batch
+     * \param seed The seed of the shuffling and of the augmentation generators
+     * \param shuffle Indicates if the samples are shuffled at each epoch
+     */
+    batch_loader(std::size_t count, std::size_t batch_size, uint64_t seed = 0, bool shuffle = true)
+            : count(count), batch_size(batch_size ? batch_size : 1), seed(seed), shuffle(shuffle) {
+        start_epoch(0);
+    }
+
+    /*!
+     * \brief Fill indices with the next batch of the current epoch
+     *
+     * The last batch of an epoch may be smaller than the batch size. At the
+     * end of an epoch, indices is left empty, false is returned and the
+     * loader moves to the next epoch.
+     *
+     * \param indices The indices of the samples of the batch
+     * \return true if a batch was produced, false at the end of the epoch
+     */
+    bool next_batch(std::vector<std::size_t>& indices) {
+        indices.clear();
+
+        if (position >= count) {
+            start_epoch(epoch + 1);
+            return false;
+        }
+
+        std::size_t n = std::min(batch_size, count - position);
+        indices.assign(permutation.begin() + position, permutation.begin() + position + n);
+        position += n;
+
+        return true;
+    }
+
+    /*!
+     * \brief Return the generator to use to augment the given sample in the current epoch
+     *
+     * The generated values do not depend on the thread or on the order in
+     * which the samples are augmented.
+     *
+     * \param index The index of the sample in the dataset
+     */
+    counter_rng sample_rng(std::size_t index) const {
+        return counter_rng(seed, epoch, index);
+    }
+
+    /*!
+     * \brief Return the current epoch
+     */
+    uint64_t current_epoch() const {
+        return epoch;
+    }
+
+    /*!
+     * \brief Return the position inside the current epoch
+     */
+    std::size_t current_position() const {
+        return position;
+    }
+
+    /*!
+     * \brief Return the complete state of the loader
+     */
+    loader_state state() const {
+        loader_state s;
+        s.seed       = seed;
+        s.epoch      = epoch;
+        s.position   = position;
+        s.count      = count;
+        s.batch_size = batch_size;
+        s.shuffle    = shuffle;
+        return s;
+    }
+
+    /*!
+     * \brief Restore the loader from a saved state
+     *
+     * The state must have been saved from a loader with the same number of
+     * samples, batch size and shuffling.
+     *
+     * \param s The state to restore
+     * \return true on success, false if the state is not valid for this loader
+     */
+    bool restore(const loader_state& s) {
+        if (s.count != count || s.batch_size != batch_size || s.shuffle != shuffle || s.position > count) {
+            std::cout << "Invalid loader state for this dataset" << std::endl;
+            return false;
+        }
+
+        seed = s.seed;
+
+        start_epoch(s.epoch);
+        position = s.position;
+
+        return true;
+    }
+
+private:
+    void start_epoch(uint64_t e) {
+        epoch    = e;
+        position = 0;
+
+        permutation.resize(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            permutation[i] = i;
+        }
+
+        if (shuffle) {
+            // Fisher-Yates with a generator that only depends on (seed, epoch)
+            counter_rng g(seed, e, ~uint64_t(0));
+            for (std::size_t i = count; i > 1; --i) {
+                std::size_t j = i <= 0xFFFFFFFFu ? g.below(static_cast<uint32_t>(i)) : static_cast<std::size_t>(g.below64(i));
+                std::swap(permutation[i - 1], permutation[j]);
+            }
+        }
+    }
+
+    std::size_t count;                    ///< The number of samples
+    std::size_t batch_size;               ///< The number of samples of each batch
+    uint64_t seed;                        ///< The seed
+    bool shuffle;                         ///< Indicates if the samples are shuffled
+    uint64_t epoch       = 0;             ///< The current epoch
+    std::size_t position = 0;             ///< The position inside the current epoch
+    std::vector<std::size_t> permutation; ///< The permutation of the current epoch
+};
+
+/*!
+ * \brief Gather the samples of a batch into contiguous buffers
+ * \param images The contiguous images of the dataset
+ * \param labels The labels of the dataset
+ * \param image_size The number of pixels of each image
+ * \param indices The indices of the samples of the batch
+ * \param batch_images The output images (indices.size() * image_size pixels)
+ * \param batch_labels The output labels (indices.size() labels)
+ */
+template <typename Pixel, typename Label>
+void gather_batch(const Pixel* images, const Label* labels, std::size_t image_size, const std::vector<std::size_t>& indices, Pixel* batch_images, Label* batch_labels) {
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        std::copy(images + indices[i] * image_size, images + (indices[i] + 1) * image_size, batch_images + i * image_size);
+        batch_labels[i] = labels[indices[i]];
+    }
+}
+
+} //end of namespace mnist
+
+#endif
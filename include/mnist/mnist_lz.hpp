@@ -0,0 +1,202 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains a small and fast LZ77-class codec
+ *
+ * The compressed stream is a sequence of sequences. Each sequence starts
+ * with a token byte whose high nibble is the number of literals and low
+ * nibble the length of the match minus 4. A nibble of 15 is followed by
+ * bytes of 255 and one final byte smaller than 255 to add to the length.
+ * Then come the literals and, except for the last sequence, the offset of
+ * the match on two bytes (little endian) and the extra match length.
+ */
+
+#ifndef MNIST_LZ_HPP
+#define MNIST_LZ_HPP
+
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+namespace mnist {
+
+namespace detail {
+
+constexpr std::size_t lz_min_match  = 4;
+constexpr std::size_t lz_max_offset = 65535;
+constexpr std::size_t lz_hash_bits  = 14;
+
+inline uint32_t lz_read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint32_t lz_hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - lz_hash_bits);
+}
+
+inline void lz_write_length(std::vector<uint8_t>& out, std::size_t length) {
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(length));
+}
+
+inline void lz_write_sequence(std::vector<uint8_t>& out, const uint8_t* literals, std::size_t literal_length, std::size_t offset, std::size_t match_length) {
+    std::size_t match_extra = match_length ? match_length - lz_min_match : 0;
+
+    uint8_t token = static_cast<uint8_t>(((literal_length < 15 ? literal_length : 15) << 4) | (match_extra < 15 ? match_extra : 15));
+    out.push_back(token);
+
+    if (literal_length >= 15) {
+        lz_write_length(out, literal_length - 15);
+    }
+
+    out.insert(out.end(), literals, literals + literal_length);
+
+    if (match_length) {
+        out.push_back(static_cast<uint8_t>(offset & 0xFF));
+        out.push_back(static_cast<uint8_t>(offset >> 8));
+
+        if (match_extra >= 15) {
+            lz_write_length(out, match_extra - 15);
+        }
+    }
+}
+
+inline bool lz_read_length(const uint8_t*& src, const uint8_t* end, std::size_t& length) {
+    uint8_t b;
+    do {
+        if (src >= end) {
+            return false;
+        }
+        b = *src++;
+        length += b;
+    } while (b == 255);
+    return true;
+}
+
+} //end of namespace detail
+
+/*!
+ * \brief Compress a buffer and append the result to out
+ * \param src The buffer to compress
+ * \param n The size of the buffer
+ * \param out The vector to append the compressed stream to
+ */
+inline void lz_compress(const uint8_t* src, std::size_t n, std::vector<uint8_t>& out) {
+    // Positions are stored + 1 so that 0 means no candidate
+    std::vector<uint32_t> table(std::size_t(1) << detail::lz_hash_bits, 0);
+
+    std::size_t anchor = 0;
+    std::size_t i      = 0;
+
+    while (i + detail::lz_min_match <= n) {
+        auto sequence  = detail::lz_read32(src + i);
+        auto h         = detail::lz_hash(sequence);
+        auto candidate = table[h];
+
+        table[h] = static_cast<uint32_t>(i + 1);
+
+        if (candidate && i - (candidate - 1) <= detail::lz_max_offset && detail::lz_read32(src + candidate - 1) == sequence) {
+            std::size_t match  = candidate - 1;
+            std::size_t length = detail::lz_min_match;
+
+            while (i + length < n && src[match + length] == src[i + length]) {
+                ++length;
+            }
+
+            detail::lz_write_sequence(out, src + anchor, i - anchor, i - match, length);
+
+            i += length;
+            anchor = i;
+        } else {
+            ++i;
+        }
+    }
+
+    // The last sequence only contains literals
+    detail::lz_write_sequence(out, src + anchor, n - anchor, 0, 0);
+}
+
+/*!
+ * \brief Decompress a stream produced by lz_compress
+ * \param src The compressed stream
+ * \param n The size of the compressed stream
+ * \param dst The output buffer
+ * \param capacity The size of the output buffer
+ * \return The number of decompressed bytes, or capacity + 1 if the stream is corrupted
+ */
+inline std::size_t lz_decompress(const uint8_t* src, std::size_t n, uint8_t* dst, std::size_t capacity) {
+    const std::size_t error = capacity + 1;
+
+    const uint8_t* end = src + n;
+    std::size_t out    = 0;
+
+    while (src < end) {
+        uint8_t token = *src++;
+
+        std::size_t literal_length = token >> 4;
+        if (literal_length == 15 && !detail::lz_read_length(src, end, literal_length)) {
+            return error;
+        }
+
+        if (literal_length > static_cast<std::size_t>(end - src) || literal_length > capacity - out) {
+            return error;
+        }
+
+        std::memcpy(dst + out, src, literal_length);
+        src += literal_length;
+        out += literal_length;
+
+        // The last sequence has no match
+        if (src == end) {
+            break;
+        }
+
+        if (end - src < 2) {
+            return error;
+        }
+
+        std::size_t offset = src[0] | (std::size_t(src[1]) << 8);
+        src += 2;
+
+        std::size_t match_length = (token & 0x0F);
+        if (match_length == 15 && !detail::lz_read_length(src, end, match_length)) {
+            return error;
+        }
+        match_length += detail::lz_min_match;
+
+        if (!offset || offset > out || match_length > capacity - out) {
+            return error;
+        }
+
+        uint8_t* d       = dst + out;
+        const uint8_t* m = d - offset;
+
+        if (offset >= match_length) {
+            std::memcpy(d, m, match_length);
+        } else {
+            // Overlapping match, the bytes must be copied one by one
+            for (std::size_t k = 0; k < match_length; ++k) {
+                d[k] = m[k];
+            }
+        }
+
+        out += match_length;
+    }
+
+    return out;
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,207 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains Mixup and CutMix batch augmentations with soft labels
+ *
+ * The augmentations work in place on contiguous batches. Each sample i is
+ * mixed with the sample n - 1 - i of the batch, which allows to mix both
+ * samples at once without any copy. Since the batches of the loader are
+ * already shuffled, this is as good as a random pairing.
+ */
+
+#ifndef MNIST_MIXUP_HPP
+#define MNIST_MIXUP_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <type_traits>
+
+#include "mnist_categorical.hpp"
+#include "mnist_random.hpp"
+
+namespace mnist {
+
+namespace detail {
+
+template <typename T>
+T mix_value(float lambda, T a, T b, std::true_type /*integral*/) {
+    // Round half away from zero, the conversion truncates toward zero
+    const float value = lambda * a + (1.0f - lambda) * b;
+    return static_cast<T>(value < 0.0f ? value - 0.5f : value + 0.5f);
+}
+
+template <typename T>
+T mix_value(float lambda, T a, T b, std::false_type /*integral*/) {
+    return static_cast<T>(lambda * a + (1.0f - lambda) * b);
+}
+
+/*!
+ * \brief Sample from Beta(alpha, alpha)
+ *
+ * The distribution is only defined for alpha > 0, otherwise no mixing is
+ * done (lambda = 1).
+ */
+inline float sample_beta(float alpha, counter_rng& rng) {
+    if (!(alpha > 0.0f)) {
+        return 1.0f;
+    }
+
+    std::gamma_distribution<float> gamma(alpha, 1.0f);
+
+    float x = gamma(rng);
+    float y = gamma(rng);
+
+    return x + y > 0.0f ? x / (x + y) : 0.5f;
+}
+
+/*!
+ * \brief Mix the soft labels of the pairs of the batch
+ */
+inline void mix_soft_labels(float* soft_labels, std::size_t n, std::size_t classes, float lambda) {
+    for (std::size_t i = 0; i < n / 2; ++i) {
+        float* a = soft_labels + i * classes;
+        float* b = soft_labels + (n - 1 - i) * classes;
+
+        for (std::size_t c = 0; c < classes; ++c) {
+            float va = a[c];
+            float vb = b[c];
+
+            a[c] = lambda * va + (1.0f - lambda) * vb;
+            b[c] = lambda * vb + (1.0f - lambda) * va;
+        }
+    }
+}
+
+} //end of namespace detail
+
+/*!
+ * \brief Apply Mixup on a batch whose labels are already soft
+ * \param images The contiguous images of the batch, mixed in place
+ * \param n The number of samples of the batch
+ * \param features The number of pixels of each image
+ * \param soft_labels The soft labels of the batch (n * classes), mixed in place
+ * \param classes The number of classes
+ * \param alpha The parameter of the Beta distribution of the mixing factor (<= 0: no mixing)
+ * \param rng The generator (for instance loader.sample_rng(first index of the batch))
+ * \return The mixing factor lambda
+ */
+template <typename T>
+float mixup_batch(T* images, std::size_t n, std::size_t features, float* soft_labels, std::size_t classes, float alpha, counter_rng rng) {
+    const float lambda = detail::sample_beta(alpha, rng);
+
+    for (std::size_t i = 0; i < n / 2; ++i) {
+        T* a = images + i * features;
+        T* b = images + (n - 1 - i) * features;
+
+        for (std::size_t j = 0; j < features; ++j) {
+            T va = a[j];
+            T vb = b[j];
+
+            a[j] = detail::mix_value(lambda, va, vb, std::is_integral<T>());
+            b[j] = detail::mix_value(lambda, vb, va, std::is_integral<T>());
+        }
+    }
+
+    detail::mix_soft_labels(soft_labels, n, classes, lambda);
+
+    return lambda;
+}
+
+/*!
+ * \brief Apply Mixup on a batch and produce its soft labels
+ * \param images The contiguous images of the batch, mixed in place
+ * \param n The number of samples of the batch
+ * \param features The number of pixels of each image
+ * \param labels The hard labels of the batch
+ * \param classes The number of classes
+ * \param soft_labels The output soft labels (n * classes)
+ * \param alpha The parameter of the Beta distribution of the mixing factor
+ * \param rng The generator
+ * \return The mixing factor lambda
+ */
+template <typename T, typename Label>
+float mixup_batch(T* images, std::size_t n, std::size_t features, const Label* labels, std::size_t classes, float* soft_labels, float alpha, counter_rng rng) {
+    encode_categorical(labels, n, classes, soft_labels);
+    return mixup_batch(images, n, features, soft_labels, classes, alpha, rng);
+}
+
+/*!
+ * \brief Apply CutMix on a batch whose labels are already soft
+ *
+ * A random box is exchanged between the two images of each pair. The
+ * labels are mixed according to the area of the box.
+ *
+ * \param images The contiguous images of the batch, modified in place
+ * \param n The number of samples of the batch
+ * \param rows The number of rows of each image
+ * \param columns The number of columns of each image
+ * \param soft_labels The soft labels of the batch (n * classes), mixed in place
+ * \param classes The number of classes
+ * \param alpha The parameter of the Beta distribution of the mixing factor
+ * \param rng The generator
+ * \return The effective mixing factor lambda (fraction of the image that is kept)
+ */
+template <typename T>
+float cutmix_batch(T* images, std::size_t n, std::size_t rows, std::size_t columns, float* soft_labels, std::size_t classes, float alpha, counter_rng rng) {
+    const float sampled = detail::sample_beta(alpha, rng);
+    const float ratio   = std::sqrt(1.0f - sampled);
+
+    const std::size_t cut_rows    = static_cast<std::size_t>(rows * ratio);
+    const std::size_t cut_columns = static_cast<std::size_t>(columns * ratio);
+
+    const std::size_t center_row    = rng.below(static_cast<uint32_t>(rows));
+    const std::size_t center_column = rng.below(static_cast<uint32_t>(columns));
+
+    const std::size_t r0 = center_row >= cut_rows / 2 ? center_row - cut_rows / 2 : 0;
+    const std::size_t c0 = center_column >= cut_columns / 2 ? center_column - cut_columns / 2 : 0;
+    const std::size_t r1 = std::min(rows, center_row + cut_rows / 2);
+    const std::size_t c1 = std::min(columns, center_column + cut_columns / 2);
+
+    const std::size_t features = rows * columns;
+
+    for (std::size_t i = 0; i < n / 2; ++i) {
+        T* a = images + i * features;
+        T* b = images + (n - 1 - i) * features;
+
+        for (std::size_t r = r0; r < r1; ++r) {
+            std::swap_ranges(a + r * columns + c0, a + r * columns + c1, b + r * columns + c0);
+        }
+    }
+
+    const float lambda = 1.0f - float((r1 - r0) * (c1 - c0)) / features;
+
+    detail::mix_soft_labels(soft_labels, n, classes, lambda);
+
+    return lambda;
+}
+
+/*!
+ * \brief Apply CutMix on a batch and produce its soft labels
+ * \param images The contiguous images of the batch, modified in place
+ * \param n The number of samples of the batch
+ * \param rows The number of rows of each image
+ * \param columns The number of columns of each image
+ * \param labels The hard labels of the batch
+ * \param classes The number of classes
+ * \param soft_labels The output soft labels (n * classes)
+ * \param alpha The parameter of the Beta distribution of the mixing factor
+ * \param rng The generator
+ * \return The effective mixing factor lambda
+ */
+template <typename T, typename Label>
+float cutmix_batch(T* images, std::size_t n, std::size_t rows, std::size_t columns, const Label* labels, std::size_t classes, float* soft_labels, float alpha, counter_rng rng) {
+    encode_categorical(labels, n, classes, soft_labels);
+    return cutmix_batch(images, n, rows, columns, soft_labels, classes, alpha, rng);
+}
+
+} //end of namespace mnist
+
+#endif
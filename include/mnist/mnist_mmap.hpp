@@ -0,0 +1,559 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains memory mappings of files and page-aware buffers
+ *
+ * On POSIX systems, the files are mapped with mmap and the buffers are
+ * anonymous mappings, which allows to request huge pages, prefaulting and
+ * locking. On other systems, the files are simply read into memory and
+ * the options are ignored.
+ */
+
+#ifndef MNIST_MMAP_HPP
+#define MNIST_MMAP_HPP
+
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MNIST_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mnist_reader_common.hpp"
+
+namespace mnist {
+
+/*!
+ * \brief Options for the allocation and the mapping of the dataset storage
+ */
+struct map_options {
+    bool huge_pages = false; ///< Request transparent huge pages (madvise(MADV_HUGEPAGE))
+    bool populate   = false; ///< Prefault all the pages (MAP_POPULATE)
+    bool lock       = false; ///< Lock the pages in memory (mlock)
+};
+
+/*!
+ * \brief The options of page_allocator, as bit flags
+ */
+enum map_flags : unsigned {
+    map_huge_pages = 1, ///< Request transparent huge pages
+    map_populate   = 2, ///< Prefault all the pages
+    map_lock       = 4  ///< Lock the pages in memory
+};
+
+namespace detail {
+
+constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+
+#ifdef MNIST_HAS_MMAP
+
+/*!
+ * \brief Apply the options on an existing mapping
+ */
+inline void apply_map_options(void* address, std::size_t length, const map_options& options) {
+#ifdef MADV_HUGEPAGE
+    if (options.huge_pages) {
+        madvise(address, length, MADV_HUGEPAGE);
+    }
+#endif
+
+    if (options.lock && mlock(address, length) != 0) {
+        std::cout << "Unable to lock the pages in memory" << std::endl;
+    }
+}
+
+#endif
+
+} //end of namespace detail
+
+/*!
+ * \brief A file mapped read-only in memory
+ */
+struct mapped_file {
+    mapped_file() = default;
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    ~mapped_file() {
+        close();
+    }
+
+    /*!
+     * \brief Map the given file
+     * \param path The path to the file
+     * \param options The mapping options
+     * \return true on success, false otherwise
+     */
+    bool open(const std::string& path, const map_options& options = map_options()) {
+        close();
+
+#ifdef MNIST_HAS_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+
+        if (fd < 0) {
+            std::cout << "Error opening file" << std::endl;
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            std::cout << "Error opening file" << std::endl;
+            return false;
+        }
+
+        length = static_cast<std::size_t>(st.st_size);
+
+        if (length) {
+            int flags = MAP_PRIVATE;
+
+#ifdef MAP_POPULATE
+            if (options.populate) {
+                flags |= MAP_POPULATE;
+            }
+#endif
+
+            void* address = mmap(nullptr, length, PROT_READ, flags, fd, 0);
+
+            if (address == MAP_FAILED) {
+                ::close(fd);
+                length = 0;
+                std::cout << "Error mapping file" << std::endl;
+                return false;
+            }
+
+            detail::apply_map_options(address, length, options);
+
+            mapping = static_cast<const char*>(address);
+        }
+
+        ::close(fd);
+#else
+        (void)options;
+
+        std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+
+        if (!file) {
+            std::cout << "Error opening file" << std::endl;
+            return false;
+        }
+
+        length = static_cast<std::size_t>(file.tellg());
+        buffer.reset(new char[length]);
+
+        file.seekg(0, std::ios::beg);
+        file.read(buffer.get(), length);
+
+        mapping = buffer.get();
+#endif
+
+        return true;
+    }
+
+    /*!
+     * \brief Unmap the file
+     */
+    void close() {
+#ifdef MNIST_HAS_MMAP
+        if (mapping) {
+            munmap(const_cast<char*>(mapping), length);
+        }
+#else
+        buffer.reset();
+#endif
+
+        mapping = nullptr;
+        length  = 0;
+    }
+
+    /*!
+     * \brief Return a pointer to the content of the file
+     */
+    const char* data() const {
+        return mapping;
+    }
+
+    /*!
+     * \brief Return the size of the file
+     */
+    std::size_t size() const {
+        return length;
+    }
+
+private:
+    const char* mapping = nullptr; ///< The mapped content
+    std::size_t length  = 0;       ///< The size of the mapping
+
+#ifndef MNIST_HAS_MMAP
+    std::unique_ptr<char[]> buffer; ///< The content of the file
+#endif
+};
+
+/*!
+ * \brief A zero-initialized buffer whose pages can be tuned for large datasets
+ *
+ * With huge pages, the buffer is aligned on a 2MB boundary so that the
+ * kernel can back it with transparent huge pages, which strongly reduces
+ * the TLB misses of random gathers over large datasets.
+ */
+struct memory_buffer {
+    memory_buffer() = default;
+
+    memory_buffer(const memory_buffer&) = delete;
+    memory_buffer& operator=(const memory_buffer&) = delete;
+
+    memory_buffer(memory_buffer&& rhs) noexcept : base(rhs.base), mapped(rhs.mapped), start(rhs.start), length(rhs.length) {
+        rhs.base   = nullptr;
+        rhs.mapped = 0;
+        rhs.start  = nullptr;
+        rhs.length = 0;
+    }
+
+    memory_buffer& operator=(memory_buffer&& rhs) noexcept {
+        if (this != &rhs) {
+            release();
+
+            std::swap(base, rhs.base);
+            std::swap(mapped, rhs.mapped);
+            std::swap(start, rhs.start);
+            std::swap(length, rhs.length);
+        }
+
+        return *this;
+    }
+
+    ~memory_buffer() {
+        release();
+    }
+
+    /*!
+     * \brief Allocate the buffer
+     * \param size The size of the buffer, in bytes
+     * \param options The allocation options
+     * \return true on success, false otherwise
+     */
+    bool allocate(std::size_t size, const map_options& options = map_options()) {
+        release();
+
+        if (!size) {
+            return true;
+        }
+
+#ifdef MNIST_HAS_MMAP
+        const std::size_t alignment = options.huge_pages ? detail::huge_page_size : 0;
+
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+        // With huge pages, the advice must be given before the pages are faulted
+#ifdef MAP_POPULATE
+        if (options.populate && !options.huge_pages) {
+            flags |= MAP_POPULATE;
+        }
+#endif
+
+        mapped = size + alignment;
+
+        void* address = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, flags, -1, 0);
+
+        if (address == MAP_FAILED) {
+            mapped = 0;
+            std::cout << "Unable to allocate memory" << std::endl;
+            return false;
+        }
+
+        base  = static_cast<char*>(address);
+        start = base;
+
+        if (alignment) {
+            auto misalignment = reinterpret_cast<std::uintptr_t>(base) % alignment;
+            start += misalignment ? alignment - misalignment : 0;
+        }
+
+        length = size;
+
+        detail::apply_map_options(start, length, options);
+
+        if (options.populate && options.huge_pages) {
+            for (std::size_t i = 0; i < length; i += 4096) {
+                start[i] = 0;
+            }
+        }
+#else
+        (void)options;
+
+        base   = new char[size]();
+        start  = base;
+        length = size;
+#endif
+
+        return true;
+    }
+
+    /*!
+     * \brief Release the memory of the buffer
+     */
+    void release() {
+#ifdef MNIST_HAS_MMAP
+        if (base) {
+            munmap(base, mapped);
+        }
+#else
+        delete[] base;
+#endif
+
+        base   = nullptr;
+        mapped = 0;
+        start  = nullptr;
+        length = 0;
+    }
+
+    /*!
+     * \brief Return a pointer to the content of the buffer
+     */
+    char* data() {
+        return start;
+    }
+
+    /*!
+     * \brief Return a pointer to the content of the buffer
+     */
+    const char* data() const {
+        return start;
+    }
+
+    /*!
+     * \brief Return the size of the buffer
+     */
+    std::size_t size() const {
+        return length;
+    }
+
+private:
+    char* base         = nullptr; ///< The start of the allocation
+    std::size_t mapped = 0;       ///< The size of the allocation
+    char* start        = nullptr; ///< The start of the (aligned) buffer
+    std::size_t length = 0;       ///< The size of the buffer
+};
+
+/*!
+ * \brief A standard allocator giving the map_options to the storage of containers
+ *
+ * The options are template flags (map_flags), so that the allocator is
+ * stateless and can be used in alias templates given to the dataset
+ * readers, for instance:
+ *
+ *     template <typename T>
+ *     using huge_vector = std::vector<T, mnist::page_allocator<T>>;
+ *
+ * Allocations of at least one huge page (2MB) are anonymous mappings,
+ * aligned on 2MB with huge pages. The smaller ones, where the options do
+ * not matter, use operator new.
+ *
+ * \tparam T The type of the allocated elements
+ * \tparam Flags The options (map_flags)
+ */
+template <typename T, unsigned Flags = map_huge_pages>
+struct page_allocator {
+    using value_type = T; ///< The type of the allocated elements
+
+    template <typename U>
+    struct rebind {
+        using other = page_allocator<U, Flags>; ///< The allocator for U
+    };
+
+    page_allocator() = default;
+
+    template <typename U>
+    page_allocator(const page_allocator<U, Flags>&) {}
+
+    /*!
+     * \brief Return the options of the allocator
+     */
+    static map_options options() {
+        map_options result;
+        result.huge_pages = Flags & map_huge_pages;
+        result.populate   = Flags & map_populate;
+        result.lock       = Flags & map_lock;
+        return result;
+    }
+
+    /*!
+     * \brief Allocate storage for n elements
+     */
+    T* allocate(std::size_t n) {
+        const std::size_t bytes = n * sizeof(T);
+
+#ifdef MNIST_HAS_MMAP
+        if (bytes >= detail::huge_page_size) {
+            const std::size_t length = mapped_size(bytes);
+            const std::size_t slack  = (Flags & map_huge_pages) ? detail::huge_page_size : 0;
+
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#ifdef MAP_POPULATE
+            // With huge pages, the advice must be given before the pages are faulted
+            if ((Flags & map_populate) && !(Flags & map_huge_pages)) {
+                flags |= MAP_POPULATE;
+            }
+#endif
+
+            void* address = mmap(nullptr, length + slack, PROT_READ | PROT_WRITE, flags, -1, 0);
+
+            if (address == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+
+            char* start = static_cast<char*>(address);
+
+            // Keep only the aligned part of the mapping
+            if (slack) {
+                auto misalignment = reinterpret_cast<std::uintptr_t>(start) % slack;
+                std::size_t head  = misalignment ? slack - misalignment : 0;
+
+                if (head) {
+                    munmap(start, head);
+                }
+
+                if (slack - head) {
+                    munmap(start + head + length, slack - head);
+                }
+
+                start += head;
+            }
+
+            auto options = page_allocator::options();
+
+            detail::apply_map_options(start, length, options);
+
+            if ((Flags & map_populate) && (Flags & map_huge_pages)) {
+                for (std::size_t i = 0; i < length; i += 4096) {
+                    start[i] = 0;
+                }
+            }
+
+            return reinterpret_cast<T*>(start);
+        }
+#endif
+
+        return static_cast<T*>(::operator new(bytes));
+    }
+
+    /*!
+     * \brief Release the storage of n elements
+     */
+    void deallocate(T* p, std::size_t n) {
+#ifdef MNIST_HAS_MMAP
+        if (n * sizeof(T) >= detail::huge_page_size) {
+            munmap(p, mapped_size(n * sizeof(T)));
+            return;
+        }
+#else
+        (void)n;
+#endif
+
+        ::operator delete(p);
+    }
+
+private:
+    static std::size_t mapped_size(std::size_t bytes) {
+        const std::size_t page = 4096;
+        return (bytes + page - 1) / page * page;
+    }
+};
+
+template <typename T, typename U, unsigned Flags>
+bool operator==(const page_allocator<T, Flags>&, const page_allocator<U, Flags>&) {
+    return true;
+}
+
+template <typename T, typename U, unsigned Flags>
+bool operator!=(const page_allocator<T, Flags>&, const page_allocator<U, Flags>&) {
+    return false;
+}
+
+/*!
+ * \brief Read all the pixels of a MNIST image file in one contiguous vector
+ *
+ * With a page_allocator, the pixels are stored with its options.
+ *
+ * \param pixels The vector to fill (count * image_size pixels)
+ * \param path The path to the image file
+ * \param image_size The output number of pixels of each image
+ * \param limit The maximum number of images to read (0: no limit)
+ * \return true on success, false otherwise
+ */
+template <typename Pixel, typename Allocator>
+bool read_mnist_pixels(std::vector<Pixel, Allocator>& pixels, const std::string& path, std::size_t& image_size, std::size_t limit = 0) {
+    auto buffer = read_mnist_file(path, 0x803);
+
+    if (buffer) {
+        std::size_t count = read_header(buffer, 1);
+        auto rows         = read_header(buffer, 2);
+        auto columns      = read_header(buffer, 3);
+
+        if (limit > 0 && count > limit) {
+            count = limit;
+        }
+
+        image_size = std::size_t(rows) * columns;
+
+        pixels.resize(count * image_size);
+        decode_bytes(reinterpret_cast<const unsigned char*>(buffer.get() + 16), pixels.size(), pixels.data());
+
+        return true;
+    } else {
+        return false;
+    }
+}
+
+/*!
+ * \brief Read a MNIST file inside a buffer allocated with the given options
+ * \param buffer The buffer to fill
+ * \param path The path to the MNIST file
+ * \param key The expected magic number
+ * \param options The allocation options
+ * \return true on success, false otherwise
+ */
+inline bool read_mnist_file(memory_buffer& buffer, const std::string& path, uint32_t key, const map_options& options) {
+    std::ifstream file;
+    file.open(path, std::ios::in | std::ios::binary | std::ios::ate);
+
+    if (!file) {
+        std::cout << "Error opening file" << std::endl;
+        return false;
+    }
+
+    auto size = static_cast<std::size_t>(file.tellg());
+
+    if (!buffer.allocate(size, options)) {
+        return false;
+    }
+
+    //Read the entire file at once
+    file.seekg(0, std::ios::beg);
+    file.read(buffer.data(), size);
+    file.close();
+
+    return check_mnist_buffer(buffer.data(), size, key);
+}
+
+} //end of namespace mnist
+
+#endif
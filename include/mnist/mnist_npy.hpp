@@ -0,0 +1,756 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains readers and writers for NumPy .npy and uncompressed .npz files
+ *
+ * The .npy files are mapped in memory and the arrays are used in place
+ * when their type matches. Only little endian hosts are supported.
+ */
+
+#ifndef MNIST_NPY_HPP
+#define MNIST_NPY_HPP
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#include "mnist_reader_common.hpp"
+#include "mnist_mmap.hpp"
+
+namespace mnist {
+
+/*!
+ * \brief Traits to get the NumPy type descriptor of a type
+ */
+template <typename T>
+struct npy_type;
+
+template <>
+struct npy_type<uint8_t> {
+    static constexpr const char* descr = "|u1";
+};
+
+template <>
+struct npy_type<int8_t> {
+    static constexpr const char* descr = "|i1";
+};
+
+template <>
+struct npy_type<uint16_t> {
+    static constexpr const char* descr = "<u2";
+};
+
+template <>
+struct npy_type<int16_t> {
+    static constexpr const char* descr = "<i2";
+};
+
+template <>
+struct npy_type<uint32_t> {
+    static constexpr const char* descr = "<u4";
+};
+
+template <>
+struct npy_type<int32_t> {
+    static constexpr const char* descr = "<i4";
+};
+
+template <>
+struct npy_type<uint64_t> {
+    static constexpr const char* descr = "<u8";
+};
+
+template <>
+struct npy_type<int64_t> {
+    static constexpr const char* descr = "<i8";
+};
+
+template <>
+struct npy_type<float> {
+    static constexpr const char* descr = "<f4";
+};
+
+template <>
+struct npy_type<double> {
+    static constexpr const char* descr = "<f8";
+};
+
+namespace detail {
+
+/*!
+ * \brief Normalize a type descriptor (byte order of single bytes types is not relevant)
+ */
+inline std::string npy_normalize_descr(std::string descr) {
+    if (descr.size() == 3 && descr[2] == '1') {
+        descr[0] = '|';
+    } else if (descr.size() == 3 && descr[0] == '=') {
+        descr[0] = '<';
+    }
+    return descr;
+}
+
+/*!
+ * \brief Build the header of a .npy file
+ */
+inline std::string npy_header(const std::string& descr, const std::vector<std::size_t>& shape) {
+    std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (";
+
+    for (std::size_t i = 0; i < shape.size(); ++i) {
+        dict += std::to_string(shape[i]);
+        if (shape.size() == 1 || i + 1 < shape.size()) {
+            dict += ",";
+        }
+        if (i + 1 < shape.size()) {
+            dict += " ";
+        }
+    }
+
+    dict += "), }";
+
+    // The data must start on a 64 bytes boundary
+    std::size_t total = 10 + dict.size() + 1;
+    dict.append((64 - total % 64) % 64, ' ');
+    dict += '\n';
+
+    std::string header("\x93NUMPY\x01\x00", 8);
+    header += static_cast<char>(dict.size() & 0xFF);
+    header += static_cast<char>(dict.size() >> 8);
+    header += dict;
+
+    return header;
+}
+
+} //end of namespace detail
+
+/*!
+ * \brief A NumPy array read from a .npy or .npz file
+ *
+ * The data points directly inside the mapped file, which is kept alive as
+ * long as the array.
+ */
+struct npy_array {
+    std::shared_ptr<mapped_file> file; ///< The mapped file holding the data
+    const char* data = nullptr;        ///< The raw data of the array
+    std::string descr;                 ///< The NumPy type descriptor
+    std::vector<std::size_t> shape;    ///< The shape of the array
+    bool fortran_order = false;        ///< Indicates if the array is stored in column-major order
+
+    /*!
+     * \brief Return the number of elements of the array
+     */
+    std::size_t size() const {
+        std::size_t n = 1;
+        for (auto d : shape) {
+            n *= d;
+        }
+        return n;
+    }
+
+    /*!
+     * \brief Return the size of one element
+     */
+    std::size_t item_size() const {
+        return descr.size() == 3 ? static_cast<std::size_t>(descr[2] - '0') : 0;
+    }
+
+    /*!
+     * \brief Indicates if the data is stored in row-major order
+     *
+     * Arrays with less than two dimensions are the same in both orders.
+     */
+    bool row_major() const {
+        return !fortran_order || shape.size() < 2;
+    }
+
+    /*!
+     * \brief Return a pointer to the data if it is stored as T, without any copy
+     * \return A pointer to the data, or nullptr if the type does not match, the data is misaligned or stored in column-major order
+     */
+    template <typename T>
+    const T* view() const {
+        if (descr != npy_type<T>::descr || !row_major() || reinterpret_cast<std::uintptr_t>(data) % alignof(T)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T*>(data);
+    }
+
+    /*!
+     * \brief Copy the data into dst in row-major order, converting it to T
+     * \param dst The output buffer (size() elements)
+     * \return true on success, false if the type of the array is not supported
+     */
+    template <typename T>
+    bool copy_to(T* dst) const {
+        if (descr == npy_type<T>::descr) {
+            if (row_major()) {
+                std::memcpy(dst, data, size() * sizeof(T));
+                return true;
+            }
+
+            return convert<T>(dst);
+        }
+
+        if (descr == "|u1") {
+            return convert<uint8_t>(dst);
+        } else if (descr == "|i1") {
+            return convert<int8_t>(dst);
+        } else if (descr == "<u2") {
+            return convert<uint16_t>(dst);
+        } else if (descr == "<i2") {
+            return convert<int16_t>(dst);
+        } else if (descr == "<u4") {
+            return convert<uint32_t>(dst);
+        } else if (descr == "<i4") {
+            return convert<int32_t>(dst);
+        } else if (descr == "<u8") {
+            return convert<uint64_t>(dst);
+        } else if (descr == "<i8") {
+            return convert<int64_t>(dst);
+        } else if (descr == "<f4") {
+            return convert<float>(dst);
+        } else if (descr == "<f8") {
+            return convert<double>(dst);
+        }
+
+        std::cout << "Unsupported NumPy type " << descr << std::endl;
+        return false;
+    }
+
+private:
+    template <typename S, typename T>
+    bool convert(T* dst) const {
+        const std::size_t n = size();
+
+        if (row_major()) {
+            for (std::size_t i = 0; i < n; ++i) {
+                S value;
+                std::memcpy(&value, data + i * sizeof(S), sizeof(S));
+                dst[i] = static_cast<T>(value);
+            }
+
+            return true;
+        }
+
+        // Column-major: the first index varies the fastest in the source
+
+        std::vector<std::size_t> strides(shape.size(), 1);
+        for (std::size_t d = shape.size() - 1; d-- > 0;) {
+            strides[d] = strides[d + 1] * shape[d + 1];
+        }
+
+        std::vector<std::size_t> index(shape.size(), 0);
+        std::size_t target = 0;
+
+        for (std::size_t i = 0; i < n; ++i) {
+            S value;
+            std::memcpy(&value, data + i * sizeof(S), sizeof(S));
+            dst[target] = static_cast<T>(value);
+
+            for (std::size_t d = 0; d < shape.size(); ++d) {
+                target += strides[d];
+
+                if (++index[d] < shape[d]) {
+                    break;
+                }
+
+                target -= strides[d] * shape[d];
+                index[d] = 0;
+            }
+        }
+
+        return true;
+    }
+};
+
+namespace detail {
+
+/*!
+ * \brief Parse a .npy file stored in memory
+ * \param array The array to fill
+ * \param data The start of the .npy content
+ * \param size The number of available bytes
+ * \return true on success, false otherwise
+ */
+inline bool parse_npy(npy_array& array, const char* data, std::size_t size) {
+    if (size < 10 || std::memcmp(data, "\x93NUMPY", 6) != 0) {
+        std::cout << "Invalid magic number, probably not a NumPy file" << std::endl;
+        return false;
+    }
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+
+    std::size_t header_length;
+    std::size_t header_start;
+
+    if (bytes[6] == 1) {
+        header_length = bytes[8] | (std::size_t(bytes[9]) << 8);
+        header_start  = 10;
+    } else if (size >= 12) {
+        header_length = bytes[8] | (std::size_t(bytes[9]) << 8) | (std::size_t(bytes[10]) << 16) | (std::size_t(bytes[11]) << 24);
+        header_start  = 12;
+    } else {
+        std::cout << "Invalid NumPy header" << std::endl;
+        return false;
+    }
+
+    if (header_start + header_length > size) {
+        std::cout << "Invalid NumPy header" << std::endl;
+        return false;
+    }
+
+    std::string header(data + header_start, header_length);
+
+    auto descr = header.find("'descr'");
+    auto order = header.find("'fortran_order'");
+    auto shape = header.find("'shape'");
+
+    if (descr == std::string::npos || order == std::string::npos || shape == std::string::npos) {
+        std::cout << "Invalid NumPy header" << std::endl;
+        return false;
+    }
+
+    auto descr_start = header.find('\'', descr + 7);
+    auto descr_end   = header.find('\'', descr_start + 1);
+
+    if (descr_start == std::string::npos || descr_end == std::string::npos) {
+        std::cout << "Invalid NumPy header" << std::endl;
+        return false;
+    }
+
+    array.descr = npy_normalize_descr(header.substr(descr_start + 1, descr_end - descr_start - 1));
+
+    auto order_value    = header.find_first_not_of(": ", order + 15);
+    array.fortran_order = order_value != std::string::npos && header.compare(order_value, 4, "True") == 0;
+
+    auto shape_start = header.find('(', shape);
+    auto shape_end   = header.find(')', shape_start);
+
+    if (shape_start == std::string::npos || shape_end == std::string::npos) {
+        std::cout << "Invalid NumPy header" << std::endl;
+        return false;
+    }
+
+    array.shape.clear();
+
+    std::size_t value = 0;
+    bool digits       = false;
+
+    for (auto i = shape_start + 1; i <= shape_end; ++i) {
+        if (header[i] >= '0' && header[i] <= '9') {
+            if (value > (std::numeric_limits<std::size_t>::max() - 9) / 10) {
+                std::cout << "Invalid NumPy shape" << std::endl;
+                return false;
+            }
+
+            value  = value * 10 + (header[i] - '0');
+            digits = true;
+        } else if (digits) {
+            array.shape.push_back(value);
+            value  = 0;
+            digits = false;
+        }
+    }
+
+    array.data = data + header_start + header_length;
+
+    // The product of the dimensions must not wrap around
+    std::size_t elements = 1;
+    for (auto d : array.shape) {
+        if (d && elements > std::numeric_limits<std::size_t>::max() / d) {
+            std::cout << "Invalid NumPy shape" << std::endl;
+            return false;
+        }
+        elements *= d;
+    }
+
+    if (!array.item_size() || elements > (size - header_start - header_length) / array.item_size()) {
+        std::cout << "The file is not large enough to hold all the data, probably corrupted" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+inline uint16_t zip_read16(const unsigned char* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t zip_read32(const unsigned char* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline uint64_t zip_read64(const unsigned char* p) {
+    return uint64_t(zip_read32(p)) | (uint64_t(zip_read32(p + 4)) << 32);
+}
+
+inline void zip_write16(std::string& out, uint32_t value) {
+    out += static_cast<char>(value & 0xFF);
+    out += static_cast<char>((value >> 8) & 0xFF);
+}
+
+inline void zip_write32(std::string& out, uint32_t value) {
+    zip_write16(out, value & 0xFFFF);
+    zip_write16(out, value >> 16);
+}
+
+/*!
+ * \brief Compute the CRC-32 (IEEE) of a buffer, as needed by the zip format
+ */
+inline uint32_t zip_crc32(uint32_t crc, const char* data, std::size_t n) {
+    static const struct table_t {
+        uint32_t values[256];
+        table_t() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                values[i] = c;
+            }
+        }
+    } table;
+
+    crc = ~crc;
+    for (std::size_t i = 0; i < n; ++i) {
+        crc = table.values[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+} //end of namespace detail
+
+/*!
+ * \brief Map a .npy file in memory
+ * \param array The array to fill
+ * \param path The path to the .npy file
+ * \return true on success, false otherwise
+ */
+inline bool read_npy(npy_array& array, const std::string& path) {
+    auto file = std::make_shared<mapped_file>();
+
+    if (!file->open(path)) {
+        return false;
+    }
+
+    array.file = file;
+
+    return detail::parse_npy(array, file->data(), file->size());
+}
+
+/*!
+ * \brief Map one array of an uncompressed .npz file in memory
+ * \param array The array to fill
+ * \param path The path to the .npz file
+ * \param name The name of the array (without the .npy extension)
+ * \return true on success, false otherwise
+ */
+inline bool read_npz(npy_array& array, const std::string& path, const std::string& name) {
+    auto file = std::make_shared<mapped_file>();
+
+    if (!file->open(path)) {
+        return false;
+    }
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(file->data());
+    const auto size   = file->size();
+
+    // Find the end of central directory record (followed by at most 64K of comment)
+
+    std::size_t eocd = std::string::npos;
+    for (std::size_t i = size >= 22 ? size - 22 + 1 : 0; i-- > 0 && size - i <= 22 + 65535;) {
+        if (detail::zip_read32(bytes + i) == 0x06054b50) {
+            eocd = i;
+            break;
+        }
+    }
+
+    if (eocd == std::string::npos) {
+        std::cout << "Invalid zip file, probably not a NumPy .npz file" << std::endl;
+        return false;
+    }
+
+    std::size_t entries = detail::zip_read16(bytes + eocd + 10);
+    std::size_t cd      = detail::zip_read32(bytes + eocd + 16);
+
+    const std::string entry_name = name + ".npy";
+
+    // The central directory ends where the end of central directory record starts
+    for (std::size_t e = 0; e < entries && cd + 46 <= eocd; ++e) {
+        if (detail::zip_read32(bytes + cd) != 0x02014b50) {
+            break;
+        }
+
+        std::size_t method       = detail::zip_read16(bytes + cd + 10);
+        std::size_t name_length  = detail::zip_read16(bytes + cd + 28);
+        std::size_t extra_length = detail::zip_read16(bytes + cd + 30);
+        std::size_t comment      = detail::zip_read16(bytes + cd + 32);
+        uint64_t local           = detail::zip_read32(bytes + cd + 42);
+
+        if (cd + 46 + name_length + extra_length > eocd) {
+            break;
+        }
+
+        if (entry_name.compare(0, std::string::npos, file->data() + cd + 46, name_length) == 0) {
+            if (method != 0) {
+                std::cout << "Compressed .npz files are not supported" << std::endl;
+                return false;
+            }
+
+            // The local header offset may be in the zip64 extra field
+            if (local == 0xFFFFFFFF) {
+                const unsigned char* extra = bytes + cd + 46 + name_length;
+                const unsigned char* end   = extra + extra_length;
+
+                while (extra + 4 <= end) {
+                    std::size_t id     = detail::zip_read16(extra);
+                    std::size_t length = detail::zip_read16(extra + 2);
+
+                    if (extra + 4 + length > end) {
+                        break;
+                    }
+
+                    if (id == 0x0001) {
+                        // The fields are only present when saturated in the record
+                        std::size_t skip = 0;
+                        skip += detail::zip_read32(bytes + cd + 24) == 0xFFFFFFFF ? 8 : 0;
+                        skip += detail::zip_read32(bytes + cd + 20) == 0xFFFFFFFF ? 8 : 0;
+
+                        if (skip + 8 <= length) {
+                            local = detail::zip_read64(extra + 4 + skip);
+                        }
+                        break;
+                    }
+
+                    extra += 4 + length;
+                }
+            }
+
+            if (local + 30 > size || detail::zip_read32(bytes + local) != 0x04034b50) {
+                std::cout << "Invalid zip file, probably corrupted" << std::endl;
+                return false;
+            }
+
+            std::size_t start = local + 30 + detail::zip_read16(bytes + local + 26) + detail::zip_read16(bytes + local + 28);
+
+            if (start > size) {
+                std::cout << "Invalid zip file, probably corrupted" << std::endl;
+                return false;
+            }
+
+            array.file = file;
+
+            return detail::parse_npy(array, file->data() + start, size - start);
+        }
+
+        cd += 46 + name_length + extra_length + comment;
+    }
+
+    std::cout << "Array " << name << " not found in " << path << std::endl;
+    return false;
+}
+
+/*!
+ * \brief Write an array to a .npy file
+ * \param path The path to the .npy file
+ * \param data The contiguous data of the array
+ * \param shape The shape of the array
+ * \return true on success, false otherwise
+ */
+template <typename T>
+bool write_npy(const std::string& path, const T* data, const std::vector<std::size_t>& shape) {
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!file) {
+        std::cout << "Error opening file" << std::endl;
+        return false;
+    }
+
+    std::size_t n = 1;
+    for (auto d : shape) {
+        n *= d;
+    }
+
+    auto header = detail::npy_header(npy_type<T>::descr, shape);
+
+    file.write(header.data(), header.size());
+    file.write(reinterpret_cast<const char*>(data), n * sizeof(T));
+
+    return static_cast<bool>(file);
+}
+
+/*!
+ * \brief An array to write inside a .npz file
+ */
+struct npz_entry {
+    std::string name;               ///< The name of the array (without the .npy extension)
+    std::string descr;              ///< The NumPy type descriptor
+    const void* data;               ///< The contiguous data of the array
+    std::size_t bytes;              ///< The size of the data
+    std::vector<std::size_t> shape; ///< The shape of the array
+};
+
+/*!
+ * \brief Describe an array to write inside a .npz file
+ * \param name The name of the array
+ * \param data The contiguous data of the array
+ * \param shape The shape of the array
+ * \return the npz entry
+ */
+template <typename T>
+npz_entry make_npz_entry(const std::string& name, const T* data, const std::vector<std::size_t>& shape) {
+    std::size_t n = 1;
+    for (auto d : shape) {
+        n *= d;
+    }
+
+    return {name, npy_type<T>::descr, data, n * sizeof(T), shape};
+}
+
+/*!
+ * \brief Write arrays to an uncompressed .npz file
+ *
+ * The zip64 extensions are not used, the file must be smaller than 4GB
+ * and contain at most 65535 arrays. The data of each array is aligned on 64
+ * bytes inside the file, with padding in the extra field of the local
+ * headers, so that the arrays can be used in place once mapped.
+ *
+ * \param path The path to the .npz file
+ * \param entries The arrays to write
+ * \return true on success, false otherwise
+ */
+inline bool write_npz(const std::string& path, const std::vector<npz_entry>& entries) {
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!file) {
+        std::cout << "Error opening file" << std::endl;
+        return false;
+    }
+
+    if (entries.size() > 0xFFFF) {
+        std::cout << "Too many arrays for a .npz file" << std::endl;
+        return false;
+    }
+
+    std::string central;
+    uint64_t offset = 0;
+
+    for (auto& entry : entries) {
+        auto header = detail::npy_header(entry.descr, entry.shape);
+        auto name   = entry.name + ".npy";
+        auto size   = header.size() + entry.bytes;
+
+        auto crc = detail::zip_crc32(0, header.data(), header.size());
+        crc      = detail::zip_crc32(crc, static_cast<const char*>(entry.data), entry.bytes);
+
+        // The npy header is a multiple of 64 bytes, align the start of the
+        // entry with an extra field (the alignment field of zipalign)
+        std::size_t padding = (64 - (offset + 30 + name.size()) % 64) % 64;
+        if (padding && padding < 4) {
+            padding += 64;
+        }
+
+        if (offset + 30 + name.size() + padding + size > 0xFFFFFFFFu) {
+            std::cout << "The .npz file is too large" << std::endl;
+            return false;
+        }
+
+        std::string local;
+        detail::zip_write32(local, 0x04034b50);
+        detail::zip_write16(local, 20);     // Version needed
+        detail::zip_write16(local, 0);      // Flags
+        detail::zip_write16(local, 0);      // Stored
+        detail::zip_write16(local, 0);      // Time
+        detail::zip_write16(local, 0x21);   // Date (1980-01-01)
+        detail::zip_write32(local, crc);
+        detail::zip_write32(local, static_cast<uint32_t>(size));
+        detail::zip_write32(local, static_cast<uint32_t>(size));
+        detail::zip_write16(local, static_cast<uint32_t>(name.size()));
+        detail::zip_write16(local, static_cast<uint32_t>(padding));
+        local += name;
+
+        if (padding) {
+            detail::zip_write16(local, 0xD935);
+            detail::zip_write16(local, static_cast<uint32_t>(padding - 4));
+            local.append(padding - 4, '\0');
+        }
+
+        detail::zip_write32(central, 0x02014b50);
+        detail::zip_write16(central, 20);   // Version made by
+        central.append(local, 4, 24);       // Same fields as the local header
+        detail::zip_write16(central, 0);    // Extra length
+        detail::zip_write16(central, 0);    // Comment length
+        detail::zip_write16(central, 0);    // Disk number
+        detail::zip_write16(central, 0);    // Internal attributes
+        detail::zip_write32(central, 0);    // External attributes
+        detail::zip_write32(central, static_cast<uint32_t>(offset));
+        central += name;
+
+        file.write(local.data(), local.size());
+        file.write(header.data(), header.size());
+        file.write(static_cast<const char*>(entry.data), entry.bytes);
+
+        offset += local.size() + size;
+    }
+
+    std::string end;
+    detail::zip_write32(end, 0x06054b50);
+    detail::zip_write16(end, 0);
+    detail::zip_write16(end, 0);
+    detail::zip_write16(end, static_cast<uint32_t>(entries.size()));
+    detail::zip_write16(end, static_cast<uint32_t>(entries.size()));
+    detail::zip_write32(end, static_cast<uint32_t>(central.size()));
+    detail::zip_write32(end, static_cast<uint32_t>(offset));
+    detail::zip_write16(end, 0);
+
+    file.write(central.data(), central.size());
+    file.write(end.data(), end.size());
+
+    return static_cast<bool>(file);
+}
+
+/*!
+ * \brief Export the MNIST dataset to a .npz file
+ *
+ * The arrays are named x_train, y_train, x_test and y_test, with the same
+ * layout as the mnist.npz file of Keras.
+ *
+ * \param folder The folder containing the MNIST files
+ * \param path The path to the .npz file
+ * \return true on success, false otherwise
+ */
+inline bool export_mnist_npz(const std::string& folder, const std::string& path) {
+    auto train_images = read_mnist_file(folder + "/train-images-idx3-ubyte", 0x803);
+    auto train_labels = read_mnist_file(folder + "/train-labels-idx1-ubyte", 0x801);
+    auto test_images  = read_mnist_file(folder + "/t10k-images-idx3-ubyte", 0x803);
+    auto test_labels  = read_mnist_file(folder + "/t10k-labels-idx1-ubyte", 0x801);
+
+    if (!train_images || !train_labels || !test_images || !test_labels) {
+        return false;
+    }
+
+    auto images = [](const std::unique_ptr<char[]>& buffer, const char* name) {
+        return make_npz_entry(name, reinterpret_cast<const uint8_t*>(buffer.get() + 16),
+                              {read_header(buffer, 1), read_header(buffer, 2), read_header(buffer, 3)});
+    };
+
+    auto labels = [](const std::unique_ptr<char[]>& buffer, const char* name) {
+        return make_npz_entry(name, reinterpret_cast<const uint8_t*>(buffer.get() + 8), {read_header(buffer, 1)});
+    };
+
+    return write_npz(path, {images(train_images, "x_train"), labels(train_labels, "y_train"), images(test_images, "x_test"), labels(test_labels, "y_test")});
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,127 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains simple helpers to run loops over several threads
+ *
+ * Using these helpers requires to link with the threads library (for
+ * instance -pthread).
+ */
+
+#ifndef MNIST_PARALLEL_HPP
+#define MNIST_PARALLEL_HPP
+
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace mnist {
+
+/*!
+ * \brief Return the number of threads to use by default
+ */
+inline std::size_t default_threads() {
+    auto n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+/*!
+ * \brief Split [first, last) in contiguous chunks and process them in parallel
+ *
+ * The last chunk is processed by the calling thread. If the functor
+ * throws, the exception is rethrown in the calling thread once all the
+ * chunks are done (the first one if several chunks throw).
+ *
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param func The functor called with the bounds (begin, end) of each chunk
+ * \param threads The number of threads to use (0: hardware concurrency)
+ */
+template <typename Functor>
+void parallel_for_chunks(std::size_t first, std::size_t last, Functor func, std::size_t threads = 0) {
+    if (last <= first) {
+        return;
+    }
+
+    const std::size_t n = last - first;
+
+    if (!threads) {
+        threads = default_threads();
+    }
+
+    if (threads > n) {
+        threads = n;
+    }
+
+    if (threads <= 1) {
+        func(first, last);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+
+    // An exception escaping a thread would terminate the program
+    std::vector<std::exception_ptr> errors(threads);
+
+    const std::size_t chunk = n / threads;
+    const std::size_t extra = n % threads;
+
+    std::size_t begin = first;
+
+    for (std::size_t t = 0; t < threads; ++t) {
+        std::size_t end = begin + chunk + (t < extra ? 1 : 0);
+
+        auto run = [&func, &errors, t, begin, end] {
+            try {
+                func(begin, end);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        };
+
+        if (t + 1 < threads) {
+            workers.emplace_back(run);
+        } else {
+            run();
+        }
+
+        begin = end;
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+/*!
+ * \brief Call the given functor for each index of [first, last) in parallel
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param func The functor called with each index
+ * \param threads The number of threads to use (0: hardware concurrency)
+ */
+template <typename Functor>
+void parallel_for(std::size_t first, std::size_t last, Functor func, std::size_t threads = 0) {
+    parallel_for_chunks(first, last, [&func](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            func(i);
+        }
+    }, threads);
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,476 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains Principal Component Analysis of images
+ *
+ * The covariance matrix is accumulated by blocks of images: each block is
+ * transposed to float so that every entry of the covariance is a
+ * contiguous dot product (a SYRK), and the rows of the covariance are
+ * distributed over the threads. For 8-bit images, the dot products of a
+ * block are exact in float. Pixels that are zero in a whole block (the
+ * borders of the digits) are skipped.
+ *
+ * The components are extracted with a full symmetric eigendecomposition
+ * (Householder tridiagonalization and implicit QL).
+ */
+
+#ifndef MNIST_PCA_HPP
+#define MNIST_PCA_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include "mnist_parallel.hpp"
+#include "mnist_simd.hpp"
+
+namespace mnist {
+
+/*!
+ * \brief A fitted PCA model
+ */
+struct MNIST_pca {
+    std::size_t features   = 0;    ///< The number of input features
+    std::size_t components = 0;    ///< The number of components
+    std::vector<float> mean;       ///< The mean image (features)
+    std::vector<float> basis;      ///< The components (components x features), by decreasing variance
+    std::vector<float> bias;       ///< The projection of the mean on each component (components)
+    std::vector<double> variances; ///< The variance explained by each component (components)
+
+    /*!
+     * \brief Project one image that is already in float
+     * \param image The image (features values)
+     * \param out The projection (components values)
+     */
+    void project(const float* image, float* out) const {
+        for (std::size_t k = 0; k < components; ++k) {
+            out[k] = detail::dot(image, basis.data() + k * features, features) - bias[k];
+        }
+    }
+};
+
+namespace detail {
+
+/*!
+ * \brief Tridiagonalize a symmetric matrix with Householder reductions
+ *
+ * a is replaced by the accumulated transformation, d and e receive the
+ * diagonal and the subdiagonal.
+ */
+inline void tridiagonalize(std::vector<double>& a, std::size_t n, std::vector<double>& d, std::vector<double>& e) {
+    auto V = [&](std::size_t i, std::size_t j) -> double& { return a[i * n + j]; };
+
+    for (std::size_t j = 0; j < n; ++j) {
+        d[j] = V(n - 1, j);
+    }
+
+    for (std::size_t i = n - 1; i > 0; --i) {
+        double scale = 0.0;
+        double h     = 0.0;
+
+        for (std::size_t k = 0; k < i; ++k) {
+            scale += std::abs(d[k]);
+        }
+
+        if (scale == 0.0) {
+            e[i] = d[i - 1];
+
+            for (std::size_t j = 0; j < i; ++j) {
+                d[j]    = V(i - 1, j);
+                V(i, j) = 0.0;
+                V(j, i) = 0.0;
+            }
+        } else {
+            for (std::size_t k = 0; k < i; ++k) {
+                d[k] /= scale;
+                h += d[k] * d[k];
+            }
+
+            double f = d[i - 1];
+            double g = std::sqrt(h);
+
+            if (f > 0) {
+                g = -g;
+            }
+
+            e[i]     = scale * g;
+            h        = h - f * g;
+            d[i - 1] = f - g;
+
+            for (std::size_t j = 0; j < i; ++j) {
+                e[j] = 0.0;
+            }
+
+            for (std::size_t j = 0; j < i; ++j) {
+                f       = d[j];
+                V(j, i) = f;
+                g       = e[j] + V(j, j) * f;
+
+                for (std::size_t k = j + 1; k < i; ++k) {
+                    g += V(k, j) * d[k];
+                    e[k] += V(k, j) * f;
+                }
+
+                e[j] = g;
+            }
+
+            f = 0.0;
+
+            for (std::size_t j = 0; j < i; ++j) {
+                e[j] /= h;
+                f += e[j] * d[j];
+            }
+
+            double hh = f / (h + h);
+
+            for (std::size_t j = 0; j < i; ++j) {
+                e[j] -= hh * d[j];
+            }
+
+            for (std::size_t j = 0; j < i; ++j) {
+                f = d[j];
+                g = e[j];
+
+                for (std::size_t k = j; k < i; ++k) {
+                    V(k, j) -= (f * e[k] + g * d[k]);
+                }
+
+                d[j]    = V(i - 1, j);
+                V(i, j) = 0.0;
+            }
+        }
+
+        d[i] = h;
+    }
+
+    // Accumulate the transformations
+    for (std::size_t i = 0; i + 1 < n; ++i) {
+        V(n - 1, i) = V(i, i);
+        V(i, i)     = 1.0;
+
+        double h = d[i + 1];
+
+        if (h != 0.0) {
+            for (std::size_t k = 0; k <= i; ++k) {
+                d[k] = V(k, i + 1) / h;
+            }
+
+            for (std::size_t j = 0; j <= i; ++j) {
+                double g = 0.0;
+
+                for (std::size_t k = 0; k <= i; ++k) {
+                    g += V(k, i + 1) * V(k, j);
+                }
+
+                for (std::size_t k = 0; k <= i; ++k) {
+                    V(k, j) -= g * d[k];
+                }
+            }
+        }
+
+        for (std::size_t k = 0; k <= i; ++k) {
+            V(k, i + 1) = 0.0;
+        }
+    }
+
+    for (std::size_t j = 0; j < n; ++j) {
+        d[j]        = V(n - 1, j);
+        V(n - 1, j) = 0.0;
+    }
+
+    V(n - 1, n - 1) = 1.0;
+    e[0]            = 0.0;
+}
+
+/*!
+ * \brief Diagonalize a symmetric tridiagonal matrix with the implicit QL algorithm
+ *
+ * The rows of w are the vectors to rotate (the transposed transformation
+ * of tridiagonalize), they become the eigenvectors of the eigenvalues d.
+ */
+inline void tridiagonal_ql(std::vector<double>& w, std::size_t n, std::vector<double>& d, std::vector<double>& e) {
+    for (std::size_t i = 1; i < n; ++i) {
+        e[i - 1] = e[i];
+    }
+
+    e[n - 1] = 0.0;
+
+    double f    = 0.0;
+    double tst1 = 0.0;
+
+    const double eps = std::pow(2.0, -52.0);
+
+    for (std::size_t l = 0; l < n; ++l) {
+        tst1 = std::max(tst1, std::abs(d[l]) + std::abs(e[l]));
+
+        std::size_t m = l;
+        while (m < n && std::abs(e[m]) > eps * tst1) {
+            ++m;
+        }
+
+        if (m > l) {
+            do {
+                double g = d[l];
+                double p = (d[l + 1] - g) / (2.0 * e[l]);
+                double r = std::hypot(p, 1.0);
+
+                if (p < 0) {
+                    r = -r;
+                }
+
+                d[l]       = e[l] / (p + r);
+                d[l + 1]   = e[l] * (p + r);
+                double dl1 = d[l + 1];
+                double h   = g - d[l];
+
+                for (std::size_t i = l + 2; i < n; ++i) {
+                    d[i] -= h;
+                }
+
+                f = f + h;
+
+                p          = d[m];
+                double c   = 1.0;
+                double c2  = c;
+                double c3  = c;
+                double el1 = e[l + 1];
+                double s   = 0.0;
+                double s2  = 0.0;
+
+                for (std::size_t i = m; i-- > l;) {
+                    c3 = c2;
+                    c2 = c;
+                    s2 = s;
+                    g  = c * e[i];
+                    h  = c * p;
+                    r  = std::hypot(p, e[i]);
+
+                    e[i + 1] = s * r;
+                    s        = e[i] / r;
+                    c        = p / r;
+                    p        = c * d[i] - s * g;
+                    d[i + 1] = h + s * (c * g + s * d[i]);
+
+                    double* wi  = w.data() + i * n;
+                    double* wi1 = w.data() + (i + 1) * n;
+
+                    for (std::size_t k = 0; k < n; ++k) {
+                        h      = wi1[k];
+                        wi1[k] = s * wi[k] + c * h;
+                        wi[k]  = c * wi[k] - s * h;
+                    }
+                }
+
+                p    = -s * s2 * c3 * el1 * e[l] / dl1;
+                e[l] = s * p;
+                d[l] = c * p;
+            } while (std::abs(e[l]) > eps * tst1);
+        }
+
+        d[l] = d[l] + f;
+        e[l] = 0.0;
+    }
+}
+
+/*!
+ * \brief Compute the eigendecomposition of a symmetric matrix
+ * \param a The matrix (n x n), replaced by the eigenvectors (one per row)
+ * \param n The size of the matrix
+ * \param values The eigenvalues, in the order of the rows of a
+ */
+inline void symmetric_eigen(std::vector<double>& a, std::size_t n, std::vector<double>& values) {
+    std::vector<double> e(n);
+    values.resize(n);
+
+    tridiagonalize(a, n, values, e);
+
+    // Transpose so that the rotations of QL work on contiguous rows
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = i + 1; j < n; ++j) {
+            std::swap(a[i * n + j], a[j * n + i]);
+        }
+    }
+
+    tridiagonal_ql(a, n, values, e);
+}
+
+} //end of namespace detail
+
+/*!
+ * \brief Compute the mean and the covariance matrix of images
+ * \param images The contiguous images (n * features pixels)
+ * \param n The number of images
+ * \param features The number of pixels of each image
+ * \param mean The output mean (features values)
+ * \param covariance The output covariance (features x features values)
+ * \param threads The number of threads to use (0: hardware concurrency)
+ */
+template <typename T>
+void compute_covariance(const T* images, std::size_t n, std::size_t features, std::vector<double>& mean, std::vector<double>& covariance, std::size_t threads = 0) {
+    constexpr std::size_t block_size = 256;
+
+    const std::size_t d = features;
+
+    mean.assign(d, 0.0);
+    covariance.assign(d * d, 0.0);
+
+    std::vector<float> block(d * block_size);
+    std::vector<std::size_t> active;
+    active.reserve(d);
+
+    for (std::size_t first = 0; first < n; first += block_size) {
+        const std::size_t rows = std::min(block_size, n - first);
+
+        // Transpose the block so that each pixel is a contiguous row
+        active.clear();
+
+        for (std::size_t i = 0; i < d; ++i) {
+            float* b = block.data() + i * block_size;
+            double sum = 0.0;
+
+            for (std::size_t r = 0; r < rows; ++r) {
+                b[r] = static_cast<float>(images[(first + r) * d + i]);
+                sum += b[r];
+            }
+
+            mean[i] += sum;
+
+            if (std::any_of(b, b + rows, [](float v) { return v != 0.0f; })) {
+                active.push_back(i);
+            }
+        }
+
+        const std::size_t na = active.size();
+
+        auto accumulate_row = [&](std::size_t p) {
+            const std::size_t i = active[p];
+            const float* bi     = block.data() + i * block_size;
+
+            for (std::size_t q = p; q < na; ++q) {
+                const std::size_t j = active[q];
+                covariance[i * d + j] += detail::dot(bi, block.data() + j * block_size, rows);
+            }
+        };
+
+        // Pair the rows p and na - 1 - p so that all the tasks have the same cost
+        parallel_for(0, (na + 1) / 2, [&](std::size_t p) {
+            accumulate_row(p);
+
+            if (na - 1 - p != p) {
+                accumulate_row(na - 1 - p);
+            }
+        }, threads);
+    }
+
+    for (std::size_t i = 0; i < d; ++i) {
+        mean[i] /= n;
+    }
+
+    const double scale = n > 1 ? 1.0 / (n - 1) : 1.0;
+
+    for (std::size_t i = 0; i < d; ++i) {
+        for (std::size_t j = i; j < d; ++j) {
+            double c = (covariance[i * d + j] - n * mean[i] * mean[j]) * scale;
+
+            covariance[i * d + j] = c;
+            covariance[j * d + i] = c;
+        }
+    }
+}
+
+/*!
+ * \brief Fit a PCA model on images
+ * \param pca The model to fit
+ * \param images The contiguous images (n * features pixels)
+ * \param n The number of images
+ * \param features The number of pixels of each image
+ * \param components The number of components to keep
+ * \param threads The number of threads to use (0: hardware concurrency)
+ * \return true on success, false otherwise
+ */
+template <typename T>
+bool fit_pca(MNIST_pca& pca, const T* images, std::size_t n, std::size_t features, std::size_t components, std::size_t threads = 0) {
+    if (!n || !features || !components || components > features) {
+        std::cout << "Invalid number of components" << std::endl;
+        return false;
+    }
+
+    std::vector<double> mean;
+    std::vector<double> covariance;
+
+    compute_covariance(images, n, features, mean, covariance, threads);
+
+    std::vector<double> values;
+    detail::symmetric_eigen(covariance, features, values);
+
+    std::vector<std::size_t> order(features);
+    for (std::size_t i = 0; i < features; ++i) {
+        order[i] = i;
+    }
+
+    std::partial_sort(order.begin(), order.begin() + components, order.end(), [&](std::size_t a, std::size_t b) { return values[a] > values[b]; });
+
+    pca.features   = features;
+    pca.components = components;
+
+    pca.mean.assign(mean.begin(), mean.end());
+    pca.basis.resize(components * features);
+    pca.bias.resize(components);
+    pca.variances.resize(components);
+
+    for (std::size_t k = 0; k < components; ++k) {
+        const double* v = covariance.data() + order[k] * features;
+
+        // Deterministic sign: the largest coordinate is positive
+        std::size_t largest = 0;
+        for (std::size_t j = 1; j < features; ++j) {
+            if (std::abs(v[j]) > std::abs(v[largest])) {
+                largest = j;
+            }
+        }
+
+        const double sign = v[largest] < 0.0 ? -1.0 : 1.0;
+
+        for (std::size_t j = 0; j < features; ++j) {
+            pca.basis[k * features + j] = static_cast<float>(sign * v[j]);
+        }
+
+        pca.bias[k]      = detail::dot(pca.mean.data(), pca.basis.data() + k * features, features);
+        pca.variances[k] = std::max(values[order[k]], 0.0);
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Project images on the components of a PCA model
+ * \param pca The fitted model
+ * \param images The contiguous images (n * pca.features pixels)
+ * \param n The number of images
+ * \param out The output projections (n * pca.components values)
+ * \param threads The number of threads to use (0: hardware concurrency)
+ */
+template <typename T>
+void pca_project(const MNIST_pca& pca, const T* images, std::size_t n, float* out, std::size_t threads = 0) {
+    parallel_for_chunks(0, n, [&](std::size_t begin, std::size_t end) {
+        std::vector<float> image(pca.features);
+
+        for (std::size_t i = begin; i < end; ++i) {
+            detail::to_float(images + i * pca.features, pca.features, image.data());
+            pca.project(image.data(), out + i * pca.components);
+        }
+    }, threads);
+}
+
+} //end of namespace mnist
+
+#endif
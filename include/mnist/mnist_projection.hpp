@@ -0,0 +1,320 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains random projection (Johnson-Lindenstrauss) embeddings of images
+ *
+ * The projection matrices are generated with the counter-based generator,
+ * one generator per output dimension, so they only depend on the seed.
+ *
+ * Dense projections use Gaussian entries. Sparse projections use entries
+ * in {-s, 0, +s}, stored as the lists of the positive and negative
+ * features of each output dimension: they only need additions, which are
+ * exact in integers for 8-bit images.
+ */
+
+#ifndef MNIST_PROJECTION_HPP
+#define MNIST_PROJECTION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#include "mnist_reader_common.hpp"
+#include "mnist_parallel.hpp"
+#include "mnist_random.hpp"
+#include "mnist_simd.hpp"
+
+namespace mnist {
+
+/*!
+ * \brief A random projection matrix
+ */
+struct MNIST_projection {
+    std::size_t features   = 0;     ///< The number of input features
+    std::size_t dimensions = 0;     ///< The number of output dimensions
+    bool sparse            = false; ///< Indicates if the projection is sparse
+
+    std::vector<float> matrix; ///< The dense matrix (dimensions x features)
+
+    std::vector<uint32_t> row_pointers; ///< The start of the features of each dimension (sparse, dimensions + 1)
+    std::vector<uint32_t> splits;       ///< The end of the positive features of each dimension (sparse, dimensions)
+    std::vector<uint16_t> columns;      ///< The positive then negative features of each dimension (sparse)
+    float scale = 1.0f;                 ///< The magnitude of the non-zero entries (sparse)
+};
+
+/*!
+ * \brief Generate a dense Gaussian projection
+ *
+ * The entries follow N(0, 1 / dimensions), so that the squared distances
+ * are preserved in expectation.
+ *
+ * \param projection The projection to generate
+ * \param features The number of input features
+ * \param dimensions The number of output dimensions
+ * \param seed The seed of the matrix
+ */
+inline void make_dense_projection(MNIST_projection& projection, std::size_t features, std::size_t dimensions, uint64_t seed) {
+    projection.features   = features;
+    projection.dimensions = dimensions;
+    projection.sparse     = false;
+
+    projection.matrix.resize(dimensions * features);
+
+    const float stddev = 1.0f / std::sqrt(static_cast<float>(dimensions));
+    const float two_pi = 6.28318530717958647692f;
+
+    for (std::size_t k = 0; k < dimensions; ++k) {
+        counter_rng rng(seed, 0, k);
+
+        float* row = projection.matrix.data() + k * features;
+
+        // Box-Muller, to get the same matrix with every standard library
+        for (std::size_t j = 0; j < features; j += 2) {
+            float u1 = 1.0f - rng.uniform();
+            float u2 = rng.uniform();
+            float r  = stddev * std::sqrt(-2.0f * std::log(u1));
+
+            row[j] = r * std::cos(two_pi * u2);
+
+            if (j + 1 < features) {
+                row[j + 1] = r * std::sin(two_pi * u2);
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Generate a sparse projection
+ *
+ * Each entry is +s or -s with probability density / 2 each and 0
+ * otherwise, with s = 1 / sqrt(density * dimensions).
+ *
+ * \param projection The projection to generate
+ * \param features The number of input features (at most 65536)
+ * \param dimensions The number of output dimensions
+ * \param seed The seed of the matrix
+ * \param density The fraction of non-zero entries (0: 1 / sqrt(features))
+ * \return true on success, false otherwise
+ */
+inline bool make_sparse_projection(MNIST_projection& projection, std::size_t features, std::size_t dimensions, uint64_t seed, float density = 0.0f) {
+    if (features > 65536) {
+        std::cout << "Too many features for a sparse projection" << std::endl;
+        return false;
+    }
+
+    if (density <= 0.0f || density > 1.0f) {
+        density = 1.0f / std::sqrt(static_cast<float>(features));
+    }
+
+    projection.features   = features;
+    projection.dimensions = dimensions;
+    projection.sparse     = true;
+    projection.scale      = 1.0f / std::sqrt(density * dimensions);
+
+    projection.row_pointers.assign(1, 0);
+    projection.splits.clear();
+    projection.columns.clear();
+
+    const uint32_t threshold = static_cast<uint32_t>(density * 4294967295.0);
+
+    std::vector<uint16_t> negatives;
+
+    for (std::size_t k = 0; k < dimensions; ++k) {
+        counter_rng rng(seed, 1, k);
+
+        negatives.clear();
+
+        for (std::size_t j = 0; j < features; ++j) {
+            uint32_t v = rng();
+
+            if (v < threshold) {
+                if (v < threshold / 2) {
+                    projection.columns.push_back(static_cast<uint16_t>(j));
+                } else {
+                    negatives.push_back(static_cast<uint16_t>(j));
+                }
+            }
+        }
+
+        projection.splits.push_back(static_cast<uint32_t>(projection.columns.size()));
+        projection.columns.insert(projection.columns.end(), negatives.begin(), negatives.end());
+        projection.row_pointers.push_back(static_cast<uint32_t>(projection.columns.size()));
+    }
+
+    return true;
+}
+
+namespace detail {
+
+/*!
+ * \brief The accumulation type of the sparse projection (exact for 8-bit images)
+ */
+template <typename T>
+struct projection_sum {
+    using type = float;
+};
+
+template <>
+struct projection_sum<uint8_t> {
+    using type = int32_t;
+};
+
+/*!
+ * \brief Compute the sparse projection of one image
+ */
+template <typename T>
+void sparse_project(const MNIST_projection& projection, const T* image, float* out) {
+    using sum_type = typename projection_sum<T>::type;
+
+    for (std::size_t k = 0; k < projection.dimensions; ++k) {
+        sum_type plus  = 0;
+        sum_type minus = 0;
+
+        for (auto p = projection.row_pointers[k]; p < projection.splits[k]; ++p) {
+            plus += image[projection.columns[p]];
+        }
+
+        for (auto p = projection.splits[k]; p < projection.row_pointers[k + 1]; ++p) {
+            minus += image[projection.columns[p]];
+        }
+
+        out[k] = projection.scale * static_cast<float>(plus - minus);
+    }
+}
+
+/*!
+ * \brief Compute the projection of one image
+ * \param image The image
+ * \param scratch The float conversion of the image (features values, dense only)
+ * \param out The output embedding (dimensions values)
+ */
+template <typename T>
+void project(const MNIST_projection& projection, const T* image, float* scratch, float* out) {
+    if (projection.sparse) {
+        sparse_project(projection, image, out);
+    } else {
+        const std::size_t features = projection.features;
+
+        to_float(image, features, scratch);
+
+        for (std::size_t k = 0; k < projection.dimensions; ++k) {
+            out[k] = dot(scratch, projection.matrix.data() + k * features, features);
+        }
+    }
+}
+
+/*!
+ * \brief Quantize a value to int8, with saturation
+ */
+inline int8_t quantize(float value, float scale) {
+    float q = std::round(value * scale);
+    return static_cast<int8_t>(std::max(-127.0f, std::min(127.0f, q)));
+}
+
+} //end of namespace detail
+
+/*!
+ * \brief Project images with a random projection
+ * \param projection The projection
+ * \param images The contiguous images (n * projection.features pixels)
+ * \param n The number of images
+ * \param out The output embeddings (n * projection.dimensions values)
+ * \param threads The number of threads to use (0: hardware concurrency)
+ */
+template <typename T>
+void random_project(const MNIST_projection& projection, const T* images, std::size_t n, float* out, std::size_t threads = 0) {
+    const std::size_t features   = projection.features;
+    const std::size_t dimensions = projection.dimensions;
+
+    parallel_for_chunks(0, n, [&](std::size_t begin, std::size_t end) {
+        std::vector<float> image(projection.sparse ? 0 : features);
+
+        for (std::size_t i = begin; i < end; ++i) {
+            detail::project(projection, images + i * features, image.data(), out + i * dimensions);
+        }
+    }, threads);
+}
+
+/*!
+ * \brief Project images with a random projection and quantize the embeddings to int8
+ *
+ * Each value is rounded after multiplication by scale and saturated to
+ * [-127, 127].
+ *
+ * \param projection The projection
+ * \param images The contiguous images (n * projection.features pixels)
+ * \param n The number of images
+ * \param out The output embeddings (n * projection.dimensions values)
+ * \param scale The quantization scale
+ * \param threads The number of threads to use (0: hardware concurrency)
+ */
+template <typename T>
+void random_project(const MNIST_projection& projection, const T* images, std::size_t n, int8_t* out, float scale, std::size_t threads = 0) {
+    const std::size_t features   = projection.features;
+    const std::size_t dimensions = projection.dimensions;
+
+    parallel_for_chunks(0, n, [&](std::size_t begin, std::size_t end) {
+        std::vector<float> image(projection.sparse ? 0 : features);
+        std::vector<float> embedding(dimensions);
+
+        for (std::size_t i = begin; i < end; ++i) {
+            detail::project(projection, images + i * features, image.data(), embedding.data());
+
+            for (std::size_t k = 0; k < dimensions; ++k) {
+                out[i * dimensions + k] = detail::quantize(embedding[k], scale);
+            }
+        }
+    }, threads);
+}
+
+/*!
+ * \brief Read a MNIST image file and project its images at once
+ * \param projection The projection
+ * \param path The path to the image file
+ * \param embeddings The output embeddings (count * projection.dimensions values)
+ * \param limit The maximum number of images to read (0: no limit)
+ * \param threads The number of threads to use (0: hardware concurrency)
+ * \return true on success, false otherwise
+ */
+inline bool read_mnist_projected_file(const MNIST_projection& projection, const std::string& path, std::vector<float>& embeddings, std::size_t limit = 0, std::size_t threads = 0) {
+    auto buffer = read_mnist_file(path, 0x803);
+
+    if (buffer) {
+        std::size_t count = read_header(buffer, 1);
+        auto rows         = read_header(buffer, 2);
+        auto columns      = read_header(buffer, 3);
+
+        if (std::size_t(rows) * columns != projection.features) {
+            std::cout << "The projection does not match the size of the images" << std::endl;
+            return false;
+        }
+
+        if (limit > 0 && count > limit) {
+            count = limit;
+        }
+
+        auto image_buffer = reinterpret_cast<const uint8_t*>(buffer.get() + 16);
+
+        embeddings.resize(count * projection.dimensions);
+        random_project(projection, image_buffer, count, embeddings.data(), threads);
+
+        return true;
+    } else {
+        return false;
+    }
+}
+
+} //end of namespace mnist
+
+#endif
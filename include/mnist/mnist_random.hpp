@@ -0,0 +1,220 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains a counter-based random generator (Philox4x32-10)
+ *
+ * The random numbers of a sample only depend on (seed, epoch, sample
+ * index), not on the order in which the samples are processed. Augmenting
+ * a dataset with any number of threads thus gives bit-identical results.
+ */
+
+#ifndef MNIST_RANDOM_HPP
+#define MNIST_RANDOM_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+namespace mnist {
+
+/*!
+ * \brief Compute one block of Philox4x32-10
+ * \param counter The counter (4 words), replaced by the random output
+ * \param key The key (2 words)
+ */
+inline void philox4x32(uint32_t counter[4], const uint32_t key[2]) {
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+
+    uint32_t c0 = counter[0];
+    uint32_t c1 = counter[1];
+    uint32_t c2 = counter[2];
+    uint32_t c3 = counter[3];
+
+    for (int round = 0; round < 10; ++round) {
+        uint64_t p0 = uint64_t(0xD2511F53u) * c0;
+        uint64_t p1 = uint64_t(0xCD9E8D57u) * c2;
+
+        uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n1 = static_cast<uint32_t>(p1);
+        uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+        uint32_t n3 = static_cast<uint32_t>(p0);
+
+        c0 = n0;
+        c1 = n1;
+        c2 = n2;
+        c3 = n3;
+
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+
+    counter[0] = c0;
+    counter[1] = c1;
+    counter[2] = c2;
+    counter[3] = c3;
+}
+
+/*!
+ * \brief A random generator keyed by (seed, epoch, sample index)
+ *
+ * It satisfies the UniformRandomBitGenerator requirements and can thus be
+ * used with the standard distributions. Creating one is free, so a new
+ * generator should be created for each sample.
+ */
+struct counter_rng {
+    using result_type = uint32_t; ///< The type of the generated values
+
+    /*!
+     * \brief Construct the generator of a sample
+     * \param seed The global seed
+     * \param epoch The epoch
+     * \param index The index of the sample
+     */
+    counter_rng(uint64_t seed, uint64_t epoch, uint64_t index) {
+        key[0]  = static_cast<uint32_t>(seed);
+        key[1]  = static_cast<uint32_t>(seed >> 32);
+        base[0] = static_cast<uint32_t>(index);
+        base[1] = static_cast<uint32_t>(index >> 32);
+        base[2] = static_cast<uint32_t>(epoch);
+        base[3] = 0;
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    /*!
+     * \brief Return the next random 32 bits value
+     */
+    result_type operator()() {
+        if (used == 4) {
+            for (int i = 0; i < 4; ++i) {
+                block[i] = base[i];
+            }
+
+            philox4x32(block, key);
+
+            ++base[3];
+            used = 0;
+        }
+
+        return block[used++];
+    }
+
+    /*!
+     * \brief Return a uniform float in [0, 1)
+     */
+    float uniform() {
+        return ((*this)() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    /*!
+     * \brief Return a uniform integer in [0, n)
+     */
+    uint32_t below(uint32_t n) {
+        // Multiply-shift reduction (Lemire), rejecting the few values that would bias it
+        uint64_t m = uint64_t((*this)()) * n;
+
+        if (static_cast<uint32_t>(m) < n) {
+            const uint32_t threshold = static_cast<uint32_t>(-n) % n;
+
+            while (static_cast<uint32_t>(m) < threshold) {
+                m = uint64_t((*this)()) * n;
+            }
+        }
+
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+    /*!
+     * rief Return a uniform 64-bit integer in [0, n)
+     */
+    uint64_t below64(uint64_t n) {
+        // The values below the threshold would make the modulo biased
+        const uint64_t threshold = (0 - n) % n;
+
+        while (true) {
+            const uint64_t hi = (*this)();
+            const uint64_t lo = (*this)();
+            const uint64_t r  = (hi << 32) | lo;
+
+            if (r >= threshold) {
+                return r % n;
+            }
+        }
+    }
+
+private:
+    uint32_t key[2];
+    uint32_t base[4];
+    uint32_t block[4] = {0, 0, 0, 0};
+    int used          = 4;
+};
+
+/*!
+ * \brief Generate the first block of random numbers of a range of samples
+ *
+ * out[4 * i] to out[4 * i + 3] are the first four values that
+ * counter_rng(seed, epoch, first + i) would generate. The blocks are
+ * independent, which lets the compiler vectorize the loop.
+ *
+ * \param seed The global seed
+ * \param epoch The epoch
+ * \param first The index of the first sample
+ * \param n The number of samples
+ * \param out The output values (4 * n values)
+ */
+inline void philox_fill(uint64_t seed, uint64_t epoch, uint64_t first, std::size_t n, uint32_t* out) {
+    const uint32_t key[2] = {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+
+    for (std::size_t i = 0; i < n; ++i) {
+        uint64_t index = first + i;
+
+        uint32_t* block = out + 4 * i;
+        block[0]        = static_cast<uint32_t>(index);
+        block[1]        = static_cast<uint32_t>(index >> 32);
+        block[2]        = static_cast<uint32_t>(epoch);
+        block[3]        = 0;
+
+        philox4x32(block, key);
+    }
+}
+
+/*!
+ * \brief Generate one uniform float in [0, 1) per sample of a range
+ *
+ * out[i] is the first value of counter_rng(seed, epoch, first + i).uniform().
+ *
+ * \param seed The global seed
+ * \param epoch The epoch
+ * \param first The index of the first sample
+ * \param n The number of samples
+ * \param out The output values (n values)
+ */
+inline void uniform_fill(uint64_t seed, uint64_t epoch, uint64_t first, std::size_t n, float* out) {
+    const uint32_t key[2] = {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+
+    for (std::size_t i = 0; i < n; ++i) {
+        uint64_t index = first + i;
+
+        uint32_t block[4] = {static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32), static_cast<uint32_t>(epoch), 0};
+        philox4x32(block, key);
+
+        out[i] = (block[0] >> 8) * (1.0f / 16777216.0f);
+    }
+}
+
+} //end of namespace mnist
+
+#endif
@@ -19,8 +19,10 @@
 #include <vector>
 #include <cstdint>
 #include <memory>
+#include <future>
 
 #include "mnist_reader_common.hpp"
+#include "mnist_direct.hpp"
 
 namespace mnist {
 
@@ -29,6 +31,10 @@ namespace mnist {
  * \tparam Container The container to use
  * \tparam Image The type of image
  * \tparam Label The type of label
+ *
+ * The functions of this header refer to it as mnist::MNIST_dataset, so
+ * that they are not ambiguous with the dataset of mnist_reader_less.hpp
+ * when both headers are included.
  */
 template <template <typename...> class Container, typename Image, typename Label>
 struct MNIST_dataset {
@@ -73,10 +79,12 @@ struct MNIST_dataset {
  * \param limit The maximum number of elements to read (0: no limit)
  * \param start The elements to ignore at the beginning
  * \param func The functor to create the image object
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  */
 template <typename Container>
-bool read_mnist_image_file_flat(Container& images, const std::string& path, std::size_t limit, std::size_t start = 0) {
-    auto buffer = read_mnist_file(path, 0x803);
+bool read_mnist_image_file_flat(Container& images, const std::string& path, std::size_t limit, std::size_t start = 0, bool verify = false, bool direct = false) {
+    auto buffer = read_mnist_file(path, 0x803, verify, direct);
 
     if (buffer) {
         auto count   = read_header(buffer, 1);
@@ -113,10 +121,12 @@ bool read_mnist_image_file_flat(Container& images, const std::string& path, std:
  * \param path The path to the image file
  * \param limit The maximum number of elements to read (0: no limit)
  * \param func The functor to create the image object
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  */
 template <template <typename...> class Container = std::vector, typename Image, typename Functor>
-void read_mnist_image_file(Container<Image>& images, const std::string& path, std::size_t limit, Functor func) {
-    auto buffer = read_mnist_file(path, 0x803);
+void read_mnist_image_file(Container<Image>& images, const std::string& path, std::size_t limit, Functor func, bool verify = false, bool direct = false) {
+    auto buffer = read_mnist_file(path, 0x803, verify, direct);
 
     if (buffer) {
         auto count   = read_header(buffer, 1);
@@ -134,13 +144,11 @@ void read_mnist_image_file(Container<Image>& images, const std::string& path, st
 
         images.reserve(count);
 
+        const std::size_t image_size = std::size_t(rows) * columns;
+
         for (size_t i = 0; i < count; ++i) {
             images.push_back(func());
-
-            for (size_t j = 0; j < rows * columns; ++j) {
-                auto pixel   = *image_buffer++;
-                images[i][j] = static_cast<typename Image::value_type>(pixel);
-            }
+            decode_bytes(images[i], image_buffer + i * image_size, image_size);
         }
     }
 }
@@ -150,10 +158,12 @@ void read_mnist_image_file(Container<Image>& images, const std::string& path, st
  * \param labels The container to fill with the labels
  * \param path The path to the label file
  * \param limit The maximum number of elements to read (0: no limit)
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  */
 template <template <typename...> class Container = std::vector, typename Label = uint8_t>
-void read_mnist_label_file(Container<Label>& labels, const std::string& path, std::size_t limit = 0) {
-    auto buffer = read_mnist_file(path, 0x801);
+void read_mnist_label_file(Container<Label>& labels, const std::string& path, std::size_t limit = 0, bool verify = false, bool direct = false) {
+    auto buffer = read_mnist_file(path, 0x801, verify, direct);
 
     if (buffer) {
         auto count = read_header(buffer, 1);
@@ -168,11 +178,7 @@ void read_mnist_label_file(Container<Label>& labels, const std::string& path, st
         }
 
         labels.resize(count);
-
-        for (size_t i = 0; i < count; ++i) {
-            auto label = *label_buffer++;
-            labels[i]  = static_cast<Label>(label);
-        }
+        decode_bytes(labels, label_buffer, count);
     }
 }
 
@@ -181,10 +187,12 @@ void read_mnist_label_file(Container<Label>& labels, const std::string& path, st
  * \param labels The container to fill with the labels
  * \param path The path to the label file
  * \param limit The maximum number of elements to read (0: no limit)
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  */
 template <typename Container>
-bool read_mnist_label_file_flat(Container& labels, const std::string& path, std::size_t limit = 0) {
-    auto buffer = read_mnist_file(path, 0x801);
+bool read_mnist_label_file_flat(Container& labels, const std::string& path, std::size_t limit = 0, bool verify = false, bool direct = false) {
+    auto buffer = read_mnist_file(path, 0x801, verify, direct);
 
     if (buffer) {
         auto count = read_header(buffer, 1);
@@ -214,10 +222,12 @@ bool read_mnist_label_file_flat(Container& labels, const std::string& path, std:
  * \param path The path to the label file
  * \param limit The maximum number of elements to read (0: no limit)
  * \param start The elements to avoid at the beginning
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  */
 template <typename Container>
-bool read_mnist_label_file_categorical(Container& labels, const std::string& path, std::size_t limit = 0, std::size_t start = 0) {
-    auto buffer = read_mnist_file(path, 0x801);
+bool read_mnist_label_file_categorical(Container& labels, const std::string& path, std::size_t limit = 0, std::size_t start = 0, bool verify = false, bool direct = false) {
+    auto buffer = read_mnist_file(path, 0x801, verify, direct);
 
     if (buffer) {
         auto count = read_header(buffer, 1);
@@ -251,12 +261,14 @@ bool read_mnist_label_file_categorical(Container& labels, const std::string& pat
  *
  * \param limit The maximum number of elements to read (0: no limit)
  * \param func The functor to create the image objects.
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  * \return Container filled with the images
  */
 template <template <typename...> class Container = std::vector, typename Image, typename Functor>
-Container<Image> read_training_images(const std::string& folder, std::size_t limit, Functor func) {
+Container<Image> read_training_images(const std::string& folder, std::size_t limit, Functor func, bool verify = false, bool direct = false) {
     Container<Image> images;
-    read_mnist_image_file<Container, Image>(images, folder + "/train-images-idx3-ubyte", limit, func);
+    read_mnist_image_file<Container, Image>(images, folder + "/train-images-idx3-ubyte", limit, func, verify, direct);
     return images;
 }
 
@@ -267,12 +279,14 @@ Container<Image> read_training_images(const std::string& folder, std::size_t lim
  *
  * \param limit The maximum number of elements to read (0: no limit)
  * \param func The functor to create the image objects.
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  * \return Container filled with the images
  */
 template <template <typename...> class Container = std::vector, typename Image, typename Functor>
-Container<Image> read_test_images(const std::string& folder, std::size_t limit, Functor func) {
+Container<Image> read_test_images(const std::string& folder, std::size_t limit, Functor func, bool verify = false, bool direct = false) {
     Container<Image> images;
-    read_mnist_image_file<Container, Image>(images, folder + "/t10k-images-idx3-ubyte", limit, func);
+    read_mnist_image_file<Container, Image>(images, folder + "/t10k-images-idx3-ubyte", limit, func, verify, direct);
     return images;
 }
 
@@ -282,12 +296,14 @@ Container<Image> read_test_images(const std::string& folder, std::size_t limit,
  * The dataset is assumed to be in a mnist subfolder
  *
  * \param limit The maximum number of elements to read (0: no limit)
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  * \return Container filled with the labels
  */
 template <template <typename...> class Container = std::vector, typename Label = uint8_t>
-Container<Label> read_training_labels(const std::string& folder, std::size_t limit) {
+Container<Label> read_training_labels(const std::string& folder, std::size_t limit, bool verify = false, bool direct = false) {
     Container<Label> labels;
-    read_mnist_label_file<Container, Label>(labels, folder + "/train-labels-idx1-ubyte", limit);
+    read_mnist_label_file<Container, Label>(labels, folder + "/train-labels-idx1-ubyte", limit, verify, direct);
     return labels;
 }
 
@@ -297,12 +313,14 @@ Container<Label> read_training_labels(const std::string& folder, std::size_t lim
  * The dataset is assumed to be in a mnist subfolder
  *
  * \param limit The maximum number of elements to read (0: no limit)
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  * \return Container filled with the labels
  */
 template <template <typename...> class Container = std::vector, typename Label = uint8_t>
-Container<Label> read_test_labels(const std::string& folder, std::size_t limit) {
+Container<Label> read_test_labels(const std::string& folder, std::size_t limit, bool verify = false, bool direct = false) {
     Container<Label> labels;
-    read_mnist_label_file<Container, Label>(labels, folder + "/t10k-labels-idx1-ubyte", limit);
+    read_mnist_label_file<Container, Label>(labels, folder + "/t10k-labels-idx1-ubyte", limit, verify, direct);
     return labels;
 }
 
@@ -313,17 +331,19 @@ Container<Label> read_test_labels(const std::string& folder, std::size_t limit)
  *
  * \param training_limit The maximum number of elements to read from training set (0: no limit)
  * \param test_limit The maximum number of elements to read from test set (0: no limit)
+ * \param verify Indicates if the CRC32C of the files is verified
+ * \param direct Indicates if the files are read with O_DIRECT, for huge one-shot loads
  * \return The dataset
  */
 template <template <typename...> class Container, typename Image, typename Label = uint8_t>
-MNIST_dataset<Container, Image, Label> read_dataset_3d(const std::string& folder, std::size_t training_limit = 0, std::size_t test_limit = 0) {
-    MNIST_dataset<Container, Image, Label> dataset;
+mnist::MNIST_dataset<Container, Image, Label> read_dataset_3d(const std::string& folder, std::size_t training_limit = 0, std::size_t test_limit = 0, bool verify = false, bool direct = false) {
+    mnist::MNIST_dataset<Container, Image, Label> dataset;
 
-    dataset.training_images = read_training_images<Container, Image>(folder, training_limit, [] { return Image(1, 28, 28); });
-    dataset.training_labels = read_training_labels<Container, Label>(folder, training_limit);
+    dataset.training_images = read_training_images<Container, Image>(folder, training_limit, [] { return Image(1, 28, 28); }, verify, direct);
+    dataset.training_labels = read_training_labels<Container, Label>(folder, training_limit, verify, direct);
 
-    dataset.test_images = read_test_images<Container, Image>(folder, test_limit, [] { return Image(1, 28, 28); });
-    dataset.test_labels = read_test_labels<Container, Label>(folder, test_limit);
+    dataset.test_images = read_test_images<Container, Image>(folder, test_limit, [] { return Image(1, 28, 28); }, verify, direct);
+    dataset.test_labels = read_test_labels<Container, Label>(folder, test_limit, verify, direct);
 
     return dataset;
 }
@@ -335,11 +355,13 @@ MNIST_dataset<Container, Image, Label> read_dataset_3d(const std::string& folder
  *
  * \param training_limit The maximum number of elements to read from training set (0: no limit)
  * \param test_limit The maximum number of elements to read from test set (0: no limit)
+ * \param verify Indicates if the CRC32C of the files is verified
+ * \param direct Indicates if the files are read with O_DIRECT, for huge one-shot loads
  * \return The dataset
  */
 template <template <typename...> class Container, typename Image, typename Label = uint8_t>
-MNIST_dataset<Container, Image, Label> read_dataset_3d(std::size_t training_limit = 0, std::size_t test_limit = 0) {
-    return read_dataset_3d<Container, Image, Label>("mnist", training_limit, test_limit);;
+mnist::MNIST_dataset<Container, Image, Label> read_dataset_3d(std::size_t training_limit = 0, std::size_t test_limit = 0, bool verify = false, bool direct = false) {
+    return read_dataset_3d<Container, Image, Label>("mnist", training_limit, test_limit, verify, direct);
 }
 
 /*!
@@ -347,17 +369,19 @@ MNIST_dataset<Container, Image, Label> read_dataset_3d(std::size_t training_limi
  *
  * \param training_limit The maximum number of elements to read from training set (0: no limit)
  * \param test_limit The maximum number of elements to read from test set (0: no limit)
+ * \param verify Indicates if the CRC32C of the files is verified
+ * \param direct Indicates if the files are read with O_DIRECT, for huge one-shot loads
  * \return The dataset
  */
 template <template <typename...> class Container, typename Image, typename Label = uint8_t>
-MNIST_dataset<Container, Image, Label> read_dataset_direct(const std::string& folder, std::size_t training_limit = 0, std::size_t test_limit = 0) {
-    MNIST_dataset<Container, Image, Label> dataset;
+mnist::MNIST_dataset<Container, Image, Label> read_dataset_direct(const std::string& folder, std::size_t training_limit = 0, std::size_t test_limit = 0, bool verify = false, bool direct = false) {
+    mnist::MNIST_dataset<Container, Image, Label> dataset;
 
-    dataset.training_images = read_training_images<Container, Image>(folder, training_limit, [] { return Image(1 * 28 * 28); });
-    dataset.training_labels = read_training_labels<Container, Label>(folder, training_limit);
+    dataset.training_images = read_training_images<Container, Image>(folder, training_limit, [] { return Image(1 * 28 * 28); }, verify, direct);
+    dataset.training_labels = read_training_labels<Container, Label>(folder, training_limit, verify, direct);
 
-    dataset.test_images = read_test_images<Container, Image>(folder, test_limit, [] { return Image(1 * 28 * 28); });
-    dataset.test_labels = read_test_labels<Container, Label>(folder, test_limit);
+    dataset.test_images = read_test_images<Container, Image>(folder, test_limit, [] { return Image(1 * 28 * 28); }, verify, direct);
+    dataset.test_labels = read_test_labels<Container, Label>(folder, test_limit, verify, direct);
 
     return dataset;
 }
@@ -369,11 +393,13 @@ MNIST_dataset<Container, Image, Label> read_dataset_direct(const std::string& fo
  *
  * \param training_limit The maximum number of elements to read from training set (0: no limit)
  * \param test_limit The maximum number of elements to read from test set (0: no limit)
+ * \param verify Indicates if the CRC32C of the files is verified
+ * \param direct Indicates if the files are read with O_DIRECT, for huge one-shot loads
  * \return The dataset
  */
 template <template <typename...> class Container, typename Image, typename Label = uint8_t>
-MNIST_dataset<Container, Image, Label> read_dataset_direct(std::size_t training_limit = 0, std::size_t test_limit = 0) {
-    return read_dataset_direct<Container, Image, Label>("mnist", training_limit, test_limit);
+mnist::MNIST_dataset<Container, Image, Label> read_dataset_direct(std::size_t training_limit = 0, std::size_t test_limit = 0, bool verify = false, bool direct = false) {
+    return read_dataset_direct<Container, Image, Label>("mnist", training_limit, test_limit, verify, direct);
 }
 
 /*!
@@ -383,11 +409,13 @@ MNIST_dataset<Container, Image, Label> read_dataset_direct(std::size_t training_
  *
  * \param training_limit The maximum number of elements to read from training set (0: no limit)
  * \param test_limit The maximum number of elements to read from test set (0: no limit)
+ * \param verify Indicates if the CRC32C of the files is verified
+ * \param direct Indicates if the files are read with O_DIRECT, for huge one-shot loads
  * \return The dataset
  */
 template <template <typename...> class Container = std::vector, template <typename...> class Sub = std::vector, typename Pixel = uint8_t, typename Label = uint8_t>
-MNIST_dataset<Container, Sub<Pixel>, Label> read_dataset(std::size_t training_limit = 0, std::size_t test_limit = 0) {
-    return read_dataset_direct<Container, Sub<Pixel>>(training_limit, test_limit);
+mnist::MNIST_dataset<Container, Sub<Pixel>, Label> read_dataset(std::size_t training_limit = 0, std::size_t test_limit = 0, bool verify = false, bool direct = false) {
+    return read_dataset_direct<Container, Sub<Pixel>>(training_limit, test_limit, verify, direct);
 }
 
 /*!
@@ -395,11 +423,119 @@ MNIST_dataset<Container, Sub<Pixel>, Label> read_dataset(std::size_t training_li
  *
  * \param training_limit The maximum number of elements to read from training set (0: no limit)
  * \param test_limit The maximum number of elements to read from test set (0: no limit)
+ * \param verify Indicates if the CRC32C of the files is verified
+ * \param direct Indicates if the files are read with O_DIRECT, for huge one-shot loads
  * \return The dataset
  */
 template <template <typename...> class Container = std::vector, template <typename...> class Sub = std::vector, typename Pixel = uint8_t, typename Label = uint8_t>
-MNIST_dataset<Container, Sub<Pixel>, Label> read_dataset(const std::string& folder, std::size_t training_limit = 0, std::size_t test_limit = 0) {
-    return read_dataset_direct<Container, Sub<Pixel>>(folder, training_limit, test_limit);
+mnist::MNIST_dataset<Container, Sub<Pixel>, Label> read_dataset(const std::string& folder, std::size_t training_limit = 0, std::size_t test_limit = 0, bool verify = false, bool direct = false) {
+    return read_dataset_direct<Container, Sub<Pixel>>(folder, training_limit, test_limit, verify, direct);
+}
+
+/*!
+ * \brief Read dataset and assume images in 3D (1x28x28), in the background
+ *
+ * The reading starts immediately in another thread, the future can be
+ * waited once the dataset is needed.
+ *
+ * \param folder The folder containing the MNIST files
+ * \param training_limit The maximum number of elements to read from training set (0: no limit)
+ * \param test_limit The maximum number of elements to read from test set (0: no limit)
+ * \param verify Indicates if the CRC32C of the files is verified
+ * \param direct Indicates if the files are read with O_DIRECT, for huge one-shot loads
+ * \return A future of the dataset
+ */
+template <template <typename...> class Container, typename Image, typename Label = uint8_t>
+std::future<mnist::MNIST_dataset<Container, Image, Label>> read_dataset_3d_async(const std::string& folder, std::size_t training_limit = 0, std::size_t test_limit = 0, bool verify = false, bool direct = false) {
+    return std::async(std::launch::async, [folder, training_limit, test_limit, verify, direct] {
+        return read_dataset_3d<Container, Image, Label>(folder, training_limit, test_limit, verify, direct);
+    });
+}
+
+/*!
+ * \brief Read dataset and assume images in 3D (1x28x28), in the background
+ *
+ * The dataset is assumed to be in a mnist subfolder
+ *
+ * \param training_limit The maximum number of elements to read from training set (0: no limit)
+ * \param test_limit The maximum number of elements to read from test set (0: no limit)
+ * \param verify Indicates if the CRC32C of the files is verified
+ * \param direct Indicates if the files are read with O_DIRECT, for huge one-shot loads
+ * \return A future of the dataset
+ */
+template <template <typename...> class Container, typename Image, typename Label = uint8_t>
+std::future<mnist::MNIST_dataset<Container, Image, Label>> read_dataset_3d_async(std::size_t training_limit = 0, std::size_t test_limit = 0, bool verify = false, bool direct = false) {
+    return read_dataset_3d_async<Container, Image, Label>("mnist", training_limit, test_limit, verify, direct);
+}
+
+/*!
+ * \brief Read dataset from some location, in the background
+ *
+ * The reading starts immediately in another thread, the future can be
+ * waited once the dataset is needed.
+ *
+ * \param folder The folder containing the MNIST files
+ * \param training_limit The maximum number of elements to read from training set (0: no limit)
+ * \param test_limit The maximum number of elements to read from test set (0: no limit)
+ * \param verify Indicates if the CRC32C of the files is verified
+ * \param direct Indicates if the files are read with O_DIRECT, for huge one-shot loads
+ * \return A future of the dataset
+ */
+template <template <typename...> class Container, typename Image, typename Label = uint8_t>
+std::future<mnist::MNIST_dataset<Container, Image, Label>> read_dataset_direct_async(const std::string& folder, std::size_t training_limit = 0, std::size_t test_limit = 0, bool verify = false, bool direct = false) {
+    return std::async(std::launch::async, [folder, training_limit, test_limit, verify, direct] {
+        return read_dataset_direct<Container, Image, Label>(folder, training_limit, test_limit, verify, direct);
+    });
+}
+
+/*!
+ * \brief Read dataset, in the background
+ *
+ * The dataset is assumed to be in a mnist subfolder
+ *
+ * \param training_limit The maximum number of elements to read from training set (0: no limit)
+ * \param test_limit The maximum number of elements to read from test set (0: no limit)
+ * \param verify Indicates if the CRC32C of the files is verified
+ * \param direct Indicates if the files are read with O_DIRECT, for huge one-shot loads
+ * \return A future of the dataset
+ */
+template <template <typename...> class Container, typename Image, typename Label = uint8_t>
+std::future<mnist::MNIST_dataset<Container, Image, Label>> read_dataset_direct_async(std::size_t training_limit = 0, std::size_t test_limit = 0, bool verify = false, bool direct = false) {
+    return read_dataset_direct_async<Container, Image, Label>("mnist", training_limit, test_limit, verify, direct);
+}
+
+/*!
+ * \brief Read dataset, in the background
+ *
+ * The dataset is assumed to be in a mnist subfolder
+ *
+ * \param training_limit The maximum number of elements to read from training set (0: no limit)
+ * \param test_limit The maximum number of elements to read from test set (0: no limit)
+ * \param verify Indicates if the CRC32C of the files is verified
+ * \param direct Indicates if the files are read with O_DIRECT, for huge one-shot loads
+ * \return A future of the dataset
+ */
+template <template <typename...> class Container = std::vector, template <typename...> class Sub = std::vector, typename Pixel = uint8_t, typename Label = uint8_t>
+std::future<mnist::MNIST_dataset<Container, Sub<Pixel>, Label>> read_dataset_async(std::size_t training_limit = 0, std::size_t test_limit = 0, bool verify = false, bool direct = false) {
+    return read_dataset_direct_async<Container, Sub<Pixel>, Label>(training_limit, test_limit, verify, direct);
+}
+
+/*!
+ * \brief Read dataset from some location, in the background
+ *
+ * The reading starts immediately in another thread, the future can be
+ * waited once the dataset is needed.
+ *
+ * \param folder The folder containing the MNIST files
+ * \param training_limit The maximum number of elements to read from training set (0: no limit)
+ * \param test_limit The maximum number of elements to read from test set (0: no limit)
+ * \param verify Indicates if the CRC32C of the files is verified
+ * \param direct Indicates if the files are read with O_DIRECT, for huge one-shot loads
+ * \return A future of the dataset
+ */
+template <template <typename...> class Container = std::vector, template <typename...> class Sub = std::vector, typename Pixel = uint8_t, typename Label = uint8_t>
+std::future<mnist::MNIST_dataset<Container, Sub<Pixel>, Label>> read_dataset_async(const std::string& folder, std::size_t training_limit = 0, std::size_t test_limit = 0, bool verify = false, bool direct = false) {
+    return read_dataset_direct_async<Container, Sub<Pixel>, Label>(folder, training_limit, test_limit, verify, direct);
 }
 
 } //end of namespace mnist
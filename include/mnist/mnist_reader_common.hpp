@@ -13,6 +13,19 @@
 #ifndef MNIST_READER_COMMON_HPP
 #define MNIST_READER_COMMON_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "mnist_crc32c.hpp"
+#include "mnist_simd.hpp"
+
 namespace mnist {
 
 /*!
@@ -21,19 +34,106 @@ namespace mnist {
  * \param position The current reading positoin
  * \return The value of the mnist header
  */
-inline uint32_t read_header(const std::unique_ptr<char[]>& buffer, size_t position) {
-    auto header = reinterpret_cast<uint32_t*>(buffer.get());
+inline uint32_t read_header(const char* buffer, size_t position) {
+    auto header = reinterpret_cast<const uint32_t*>(buffer);
 
     auto value = *(header + position);
     return (value << 24) | ((value << 8) & 0x00FF0000) | ((value >> 8) & 0X0000FF00) | (value >> 24);
 }
 
+/*!
+ * \brief Extract the MNIST header from the given buffer
+ * \param buffer The current buffer
+ * \param position The current reading positoin
+ * \return The value of the mnist header
+ */
+inline uint32_t read_header(const std::unique_ptr<char[]>& buffer, size_t position) {
+    return read_header(buffer.get(), position);
+}
+
+/*!
+ * \brief Check that a buffer holds a complete MNIST file
+ * \param buffer The content of the file
+ * \param size The size of the file
+ * \param key The expected magic number
+ * \return true if the buffer is valid, false otherwise
+ */
+inline bool check_mnist_buffer(const char* buffer, std::size_t size, uint32_t key) {
+    if (size < 8) {
+        std::cout << "The file is not large enough to hold all the data, probably corrupted" << std::endl;
+        return false;
+    }
+
+    auto magic = read_header(buffer, 0);
+
+    if (magic != key) {
+        std::cout << "Invalid magic number, probably not a MNIST file" << std::endl;
+        return false;
+    }
+
+    std::size_t count = read_header(buffer, 1);
+
+    if (magic == 0x803) {
+        if (size < 16) {
+            std::cout << "The file is not large enough to hold all the data, probably corrupted" << std::endl;
+            return false;
+        }
+
+        std::size_t rows    = read_header(buffer, 2);
+        std::size_t columns = read_header(buffer, 3);
+
+        if (size < count * rows * columns + 16) {
+            std::cout << "The file is not large enough to hold all the data, probably corrupted" << std::endl;
+            return false;
+        }
+    } else if (magic == 0x801) {
+        if (size < count + 8) {
+            std::cout << "The file is not large enough to hold all the data, probably corrupted" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Verify the CRC32C of the content of a MNIST file
+ *
+ * The expected checksum is read from the sidecar file of the file (path +
+ * ".crc32c") when there is one and is the known checksum of the standard
+ * MNIST file otherwise.
+ *
+ * \param buffer The content of the file
+ * \param size The size of the file
+ * \param path The path to the file
+ * \return true if the content matches the checksum, false otherwise
+ */
+inline bool verify_mnist_buffer(const char* buffer, std::size_t size, const std::string& path) {
+    uint32_t expected = 0;
+
+    if (!read_crc32c_file(path, expected, true)) {
+        if (size < 8 || !known_mnist_crc32c(read_header(buffer, 0), read_header(buffer, 1), expected)) {
+            std::cout << "No known checksum for " << path << std::endl;
+            return false;
+        }
+    }
+
+    if (crc32c(buffer, size) != expected) {
+        std::cout << "Checksum mismatch for " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
 /*!
  * \brief Read a MNIST file inside a raw buffer
  * \param path The path to the image file
+ * \param key The expected magic number
+ * \param verify Indicates if the CRC32C of the file is verified (see verify_mnist_buffer)
  * \return The buffer of byte on success, a nullptr-unique_ptr otherwise
  */
-inline std::unique_ptr<char[]> read_mnist_file(const std::string& path, uint32_t key) {
+inline std::unique_ptr<char[]> read_mnist_file(const std::string& path, uint32_t key, bool verify = false) {
     std::ifstream file;
     file.open(path, std::ios::in | std::ios::binary | std::ios::ate);
 
@@ -50,31 +150,85 @@ inline std::unique_ptr<char[]> read_mnist_file(const std::string& path, uint32_t
     file.read(buffer.get(), size);
     file.close();
 
-    auto magic = read_header(buffer, 0);
+    if (!check_mnist_buffer(buffer.get(), static_cast<std::size_t>(size), key)) {
+        return {};
+    }
 
-    if (magic != key) {
-        std::cout << "Invalid magic number, probably not a MNIST file" << std::endl;
+    if (verify && !verify_mnist_buffer(buffer.get(), static_cast<std::size_t>(size), path)) {
         return {};
     }
 
-    auto count = read_header(buffer, 1);
+    return buffer;
+}
 
-    if (magic == 0x803) {
-        auto rows    = read_header(buffer, 2);
-        auto columns = read_header(buffer, 3);
+/*!
+ * \brief Decode the bytes of a MNIST file into contiguous pixels or labels
+ * \param src The bytes of the file
+ * \param n The number of values to decode
+ * \param dst The output values
+ */
+template <typename T>
+void decode_bytes(const unsigned char* src, std::size_t n, T* dst) {
+    for (std::size_t i = 0; i < n; ++i) {
+        dst[i] = static_cast<T>(src[i]);
+    }
+}
 
-        if (size < count * rows * columns + 16) {
-            std::cout << "The file is not large enough to hold all the data, probably corrupted" << std::endl;
-            return {};
-        }
-    } else if (magic == 0x801) {
-        if (size < count + 8) {
-            std::cout << "The file is not large enough to hold all the data, probably corrupted" << std::endl;
-            return {};
-        }
+/*!
+ * \brief Decode the bytes of a MNIST file into contiguous bytes
+ */
+inline void decode_bytes(const unsigned char* src, std::size_t n, uint8_t* dst) {
+    if (n) {
+        std::memcpy(dst, src, n);
     }
+}
 
-    return buffer;
+/*!
+ * \brief Decode the bytes of a MNIST file into contiguous floats
+ */
+inline void decode_bytes(const unsigned char* src, std::size_t n, float* dst) {
+    detail::to_float(src, n, dst);
+}
+
+namespace detail {
+
+/*!
+ * \brief Traits indicating if a container stores its values contiguously behind data()
+ */
+template <typename Container, typename Enable = void>
+struct has_contiguous_data : std::false_type {};
+
+template <typename Container>
+struct has_contiguous_data<Container, typename std::enable_if<std::is_same<decltype(std::declval<Container&>().data()), typename Container::value_type*>::value>::type>
+        : std::true_type {};
+
+template <typename Container>
+void decode_into(Container& container, const unsigned char* src, std::size_t n, std::true_type /*contiguous*/) {
+    decode_bytes(src, n, container.data());
+}
+
+template <typename Container>
+void decode_into(Container& container, const unsigned char* src, std::size_t n, std::false_type /*contiguous*/) {
+    for (std::size_t i = 0; i < n; ++i) {
+        container[i] = static_cast<typename Container::value_type>(src[i]);
+    }
+}
+
+} //end of namespace detail
+
+/*!
+ * \brief Decode the bytes of a MNIST file into the first n values of a container
+ *
+ * The contiguous containers (with a data() member) are decoded with
+ * decode_bytes, the others value by value.
+ *
+ * \param container The container to fill, with at least n values
+ * \param src The bytes of the file
+ * \param n The number of values to decode
+ */
+template <typename Container>
+void decode_bytes(Container& container, const unsigned char* src, std::size_t n) {
+    detail::decode_into(container, src, n, detail::has_contiguous_data<Container>());
 }
 
 } //end of namespace mnist
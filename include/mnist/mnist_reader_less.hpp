@@ -10,10 +10,20 @@
  * \brief Contains functions to read the MNIST dataset (less features, Visual Studio friendly)
  *
  * This header should only be used with old compilers.
+ *
+ * The functions are declared in the mnist::less namespace and are also
+ * available in the mnist namespace. When mnist_reader.hpp is included in
+ * the same translation unit, the functions of both headers are overloads
+ * of each other: mnist::read_dataset<uint8_t, uint8_t>() reads a dataset
+ * of this header and mnist::read_dataset<std::vector, std::vector,
+ * uint8_t, uint8_t>() one of mnist_reader.hpp. A call without template
+ * arguments is ambiguous and mnist::MNIST_dataset is the dataset of
+ * mnist_reader.hpp, the ones of this header must then be spelled with
+ * mnist::less::.
  */
 
-#ifndef MNIST_READER_HPP
-#define MNIST_READER_HPP
+#ifndef MNIST_READER_LESS_HPP
+#define MNIST_READER_LESS_HPP
 
 #include <fstream>
 #include <iostream>
@@ -23,9 +33,12 @@
 #include <memory>
 
 #include "mnist_reader_common.hpp"
+#include "mnist_direct.hpp"
 
 namespace mnist {
 
+namespace less {
+
 /*!
  * \brief Represents a complete mnist dataset
  * \tparam Pixel The type of a pixel
@@ -39,35 +52,68 @@ struct MNIST_dataset {
     std::vector<Label> test_labels;                  ///< The test labels
 };
 
+/*!
+ * \brief Read a MNIST image file and return all the pixels in one contiguous container
+ * \param path The path to the image file
+ * \param image_size The output number of pixels of each image
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
+ * \return A std::vector filled with the pixels of all the images
+ */
+template <typename Pixel = uint8_t>
+std::vector<Pixel> read_mnist_image_file_contiguous(const std::string& path, std::size_t& image_size, bool verify = false, bool direct = false) {
+    auto buffer = read_mnist_file(path, 0x803, verify, direct);
+
+    if (buffer) {
+        std::size_t count = read_header(buffer, 1);
+        auto rows         = read_header(buffer, 2);
+        auto columns      = read_header(buffer, 3);
+
+        image_size = std::size_t(rows) * columns;
+
+        //Skip the header
+        //Cast to unsigned char is necessary cause signedness of char is
+        //platform-specific
+        auto image_buffer = reinterpret_cast<unsigned char*>(buffer.get() + 16);
+
+        std::vector<Pixel> pixels(count * image_size);
+        decode_bytes(image_buffer, pixels.size(), pixels.data());
+
+        return pixels;
+    }
+
+    image_size = 0;
+
+    return {};
+}
+
 /*!
  * \brief Read a MNIST image file and return a container filled with the images
  * \param path The path to the image file
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  * \return A std::vector filled with the read images
  */
 template <typename Pixel = uint8_t, typename Label = uint8_t>
-std::vector<std::vector<Pixel>> read_mnist_image_file(const std::string& path) {
-    auto buffer = read_mnist_file(path, 0x803);
+std::vector<std::vector<Pixel>> read_mnist_image_file(const std::string& path, bool verify = false, bool direct = false) {
+    auto buffer = read_mnist_file(path, 0x803, verify, direct);
 
     if (buffer) {
-        auto count   = read_header(buffer, 1);
-        auto rows    = read_header(buffer, 2);
-        auto columns = read_header(buffer, 3);
+        std::size_t count = read_header(buffer, 1);
+        auto rows         = read_header(buffer, 2);
+        auto columns      = read_header(buffer, 3);
+
+        const std::size_t image_size = std::size_t(rows) * columns;
 
         //Skip the header
         //Cast to unsigned char is necessary cause signedness of char is
         //platform-specific
         auto image_buffer = reinterpret_cast<unsigned char*>(buffer.get() + 16);
 
-        std::vector<std::vector<Pixel>> images;
-        images.reserve(count);
-
-        for (size_t i = 0; i < count; ++i) {
-            images.emplace_back(rows * columns);
+        std::vector<std::vector<Pixel>> images(count, std::vector<Pixel>(image_size));
 
-            for (size_t j = 0; j < rows * columns; ++j) {
-                auto pixel   = *image_buffer++;
-                images[i][j] = static_cast<Pixel>(pixel);
-            }
+        for (std::size_t i = 0; i < count; ++i) {
+            decode_bytes(image_buffer + i * image_size, image_size, images[i].data());
         }
 
         return images;
@@ -79,14 +125,16 @@ std::vector<std::vector<Pixel>> read_mnist_image_file(const std::string& path) {
 /*!
  * \brief Read a MNIST label file and return a container filled with the labels
  * \param path The path to the image file
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  * \return A std::vector filled with the read labels
  */
 template <typename Label = uint8_t>
-std::vector<Label> read_mnist_label_file(const std::string& path) {
-    auto buffer = read_mnist_file(path, 0x801);
+std::vector<Label> read_mnist_label_file(const std::string& path, bool verify = false, bool direct = false) {
+    auto buffer = read_mnist_file(path, 0x801, verify, direct);
 
     if (buffer) {
-        auto count = read_header(buffer, 1);
+        std::size_t count = read_header(buffer, 1);
 
         //Skip the header
         //Cast to unsigned char is necessary cause signedness of char is
@@ -94,11 +142,7 @@ std::vector<Label> read_mnist_label_file(const std::string& path) {
         auto label_buffer = reinterpret_cast<unsigned char*>(buffer.get() + 8);
 
         std::vector<Label> labels(count);
-
-        for (size_t i = 0; i < count; ++i) {
-            auto label = *label_buffer++;
-            labels[i]  = static_cast<Label>(label);
-        }
+        decode_bytes(label_buffer, count, labels.data());
 
         return labels;
     }
@@ -111,11 +155,13 @@ std::vector<Label> read_mnist_label_file(const std::string& path) {
  *
  * The dataset is assumed to be in a mnist subfolder
  *
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  * \return Container filled with the images
  */
 template <typename Pixel = uint8_t>
-std::vector<std::vector<Pixel>> read_training_images() {
-    return read_mnist_image_file<Pixel>("mnist/train-images-idx3-ubyte");
+std::vector<std::vector<Pixel>> read_training_images(bool verify = false, bool direct = false) {
+    return read_mnist_image_file<Pixel>("mnist/train-images-idx3-ubyte", verify, direct);
 }
 
 /*!
@@ -123,11 +169,13 @@ std::vector<std::vector<Pixel>> read_training_images() {
  *
  * The dataset is assumed to be in a mnist subfolder
  *
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  * \return Container filled with the images
  */
 template <typename Pixel = uint8_t>
-std::vector<std::vector<Pixel>> read_test_images() {
-    return read_mnist_image_file<Pixel>("mnist/t10k-images-idx3-ubyte");
+std::vector<std::vector<Pixel>> read_test_images(bool verify = false, bool direct = false) {
+    return read_mnist_image_file<Pixel>("mnist/t10k-images-idx3-ubyte", verify, direct);
 }
 
 /*!
@@ -135,11 +183,13 @@ std::vector<std::vector<Pixel>> read_test_images() {
  *
  * The dataset is assumed to be in a mnist subfolder
  *
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  * \return Container filled with the labels
  */
 template <typename Label = uint8_t>
-std::vector<Label> read_training_labels() {
-    return read_mnist_label_file<Label>("mnist/train-labels-idx1-ubyte");
+std::vector<Label> read_training_labels(bool verify = false, bool direct = false) {
+    return read_mnist_label_file<Label>("mnist/train-labels-idx1-ubyte", verify, direct);
 }
 
 /*!
@@ -147,11 +197,13 @@ std::vector<Label> read_training_labels() {
  *
  * The dataset is assumed to be in a mnist subfolder
  *
+ * \param verify Indicates if the CRC32C of the file is verified
+ * \param direct Indicates if the file is read with O_DIRECT, for huge one-shot loads
  * \return Container filled with the labels
  */
 template <typename Label = uint8_t>
-std::vector<Label> read_test_labels() {
-    return read_mnist_label_file<Label>("mnist/t10k-labels-idx1-ubyte");
+std::vector<Label> read_test_labels(bool verify = false, bool direct = false) {
+    return read_mnist_label_file<Label>("mnist/t10k-labels-idx1-ubyte", verify, direct);
 }
 
 /*!
@@ -159,21 +211,40 @@ std::vector<Label> read_test_labels() {
  *
  * The dataset is assumed to be in a mnist subfolder
  *
+ * \param verify Indicates if the CRC32C of the files is verified
+ * \param direct Indicates if the files are read with O_DIRECT, for huge one-shot loads
  * \return The dataset
  */
 template <typename Pixel = uint8_t, typename Label = uint8_t>
-MNIST_dataset<Pixel, Label> read_dataset() {
+MNIST_dataset<Pixel, Label> read_dataset(bool verify = false, bool direct = false) {
     MNIST_dataset<Pixel, Label> dataset;
 
-    dataset.training_images = read_training_images<Pixel>();
-    dataset.training_labels = read_training_labels<Label>();
+    dataset.training_images = read_training_images<Pixel>(verify, direct);
+    dataset.training_labels = read_training_labels<Label>(verify, direct);
 
-    dataset.test_images = read_test_images<Pixel>();
-    dataset.test_labels = read_test_labels<Label>();
+    dataset.test_images = read_test_images<Pixel>(verify, direct);
+    dataset.test_labels = read_test_labels<Label>(verify, direct);
 
     return dataset;
 }
 
+} //end of namespace less
+
+// The functions are overloaded with the ones of mnist_reader.hpp, their
+// template parameters (types instead of containers) select the right one
+using less::read_mnist_image_file_contiguous;
+using less::read_mnist_image_file;
+using less::read_mnist_label_file;
+using less::read_training_images;
+using less::read_test_images;
+using less::read_training_labels;
+using less::read_test_labels;
+using less::read_dataset;
+
+// The dataset type can only be named mnist::MNIST_dataset when
+// mnist_reader.hpp is not included
+using namespace less;
+
 } //end of namespace mnist
 
 #endif
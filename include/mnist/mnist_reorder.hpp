@@ -0,0 +1,205 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains the in-place reordering of a dataset by class or by key
+ *
+ * The images and labels are permuted by following the cycles of the
+ * permutation: each image is moved exactly once and only one temporary
+ * image is needed, whatever the size of the dataset.
+ */
+
+#ifndef MNIST_REORDER_HPP
+#define MNIST_REORDER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "mnist_class_index.hpp"
+
+namespace mnist {
+
+namespace detail {
+
+/*!
+ * \brief Follow the cycles of a permutation
+ *
+ * For each cycle, save(p) is called on its first position, then
+ * move(j, k) moves the element k to the position j, and restore(j) puts
+ * the saved element at the last position of the cycle.
+ *
+ * \param order The permutation (order[p] is the source of the position p), destroyed
+ */
+template <typename Save, typename Move, typename Restore>
+void follow_cycles(std::vector<std::size_t>& order, Save save, Move move, Restore restore) {
+    for (std::size_t p = 0; p < order.size(); ++p) {
+        if (order[p] == p) {
+            continue;
+        }
+
+        save(p);
+
+        std::size_t j = p;
+
+        while (order[j] != p) {
+            std::size_t k = order[j];
+
+            move(j, k);
+
+            order[j] = j;
+            j        = k;
+        }
+
+        restore(j);
+        order[j] = j;
+    }
+}
+
+/*!
+ * \brief Return the permutation grouping the samples by key
+ *
+ * The samples whose key is not smaller than key_count are not in the
+ * class index, they are moved after the last group, in order.
+ */
+template <typename Key>
+std::vector<std::size_t> group_order(class_index& index, const Key* keys, std::size_t n, std::size_t key_count) {
+    make_class_index(index, keys, n, key_count);
+
+    std::vector<std::size_t> order = std::move(index.indices);
+
+    for (std::size_t i = 0; order.size() < n; ++i) {
+        if (static_cast<std::size_t>(keys[i]) >= index.classes()) {
+            order.push_back(i);
+        }
+    }
+
+    return order;
+}
+
+} //end of namespace detail
+
+/*!
+ * \brief Permute contiguous images and labels in place
+ * \param images The contiguous images (n * image_size pixels)
+ * \param labels The labels (n labels)
+ * \param image_size The number of pixels of each image
+ * \param order The permutation: the sample order[p] is moved to the position p
+ */
+template <typename Pixel, typename Label>
+void permute_in_place(Pixel* images, Label* labels, std::size_t image_size, std::vector<std::size_t> order) {
+    std::vector<Pixel> image(image_size);
+    Label label = Label();
+
+    detail::follow_cycles(order,
+        [&](std::size_t p) {
+            std::copy(images + p * image_size, images + (p + 1) * image_size, image.begin());
+            label = labels[p];
+        },
+        [&](std::size_t j, std::size_t k) {
+            std::copy(images + k * image_size, images + (k + 1) * image_size, images + j * image_size);
+            labels[j] = labels[k];
+        },
+        [&](std::size_t j) {
+            std::copy(image.begin(), image.end(), images + j * image_size);
+            labels[j] = label;
+        });
+}
+
+/*!
+ * \brief Permute a container of images and a container of labels in place
+ *
+ * The images are moved, not copied.
+ *
+ * \param images The images
+ * \param labels The labels
+ * \param order The permutation: the sample order[p] is moved to the position p
+ */
+template <typename Container, typename Label>
+void permute_in_place(Container& images, std::vector<Label>& labels, std::vector<std::size_t> order) {
+    typename Container::value_type image;
+    Label label = Label();
+
+    detail::follow_cycles(order,
+        [&](std::size_t p) {
+            image = std::move(images[p]);
+            label = labels[p];
+        },
+        [&](std::size_t j, std::size_t k) {
+            images[j] = std::move(images[k]);
+            labels[j] = labels[k];
+        },
+        [&](std::size_t j) {
+            images[j] = std::move(image);
+            labels[j] = label;
+        });
+}
+
+/*!
+ * \brief Group contiguous images and labels by key, in place
+ *
+ * The order of the samples with the same key is preserved. keys may be
+ * the labels themselves. The samples whose key is not smaller than
+ * key_count are moved after the last group.
+ *
+ * \param images The contiguous images (n * image_size pixels)
+ * \param labels The labels (n labels)
+ * \param n The number of samples
+ * \param image_size The number of pixels of each image
+ * \param keys The key of each sample, small integers
+ * \param key_count The number of keys (0: the largest key + 1)
+ * \return The offsets of each key in the new layout (key_count + 1)
+ */
+template <typename Pixel, typename Label, typename Key>
+std::vector<std::size_t> group_by_key(Pixel* images, Label* labels, std::size_t n, std::size_t image_size, const Key* keys, std::size_t key_count = 0) {
+    class_index index;
+
+    permute_in_place(images, labels, image_size, detail::group_order(index, keys, n, key_count));
+
+    return std::move(index.offsets);
+}
+
+/*!
+ * \brief Group contiguous images and labels by class, in place
+ * \param images The contiguous images (n * image_size pixels)
+ * \param labels The labels (n labels)
+ * \param n The number of samples
+ * \param image_size The number of pixels of each image
+ * \param classes The number of classes (0: the largest label + 1)
+ * \return The offsets of each class in the new layout (classes + 1)
+ */
+template <typename Pixel, typename Label>
+std::vector<std::size_t> group_by_class(Pixel* images, Label* labels, std::size_t n, std::size_t image_size, std::size_t classes = 0) {
+    return group_by_key(images, labels, n, image_size, labels, classes);
+}
+
+/*!
+ * \brief Group a container of images and a container of labels by class, in place
+ *
+ * The samples whose label is not smaller than classes are moved after the
+ * last class.
+ *
+ * \param images The images
+ * \param labels The labels
+ * \param classes The number of classes (0: the largest label + 1)
+ * \return The offsets of each class in the new layout (classes + 1)
+ */
+template <typename Container, typename Label>
+std::vector<std::size_t> group_by_class(Container& images, std::vector<Label>& labels, std::size_t classes = 0) {
+    class_index index;
+
+    permute_in_place(images, labels, detail::group_order(index, labels.data(), labels.size(), classes));
+
+    return std::move(index.offsets);
+}
+
+} //end of namespace mnist
+
+#endif
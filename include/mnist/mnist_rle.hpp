@@ -0,0 +1,189 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains a run-length compressed in-memory image store
+ */
+
+#ifndef MNIST_RLE_HPP
+#define MNIST_RLE_HPP
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#include "mnist_reader_common.hpp"
+
+namespace mnist {
+
+/*!
+ * \brief A set of images whose zero runs are run-length encoded
+ *
+ * Each image is encoded as a sequence of tokens. A token is made of a
+ * number of zeros, a number of literals and the literals themselves. Both
+ * counts are stored on one byte, longer runs are split in several tokens.
+ * Decoding a token is a single memset and a single memcpy.
+ */
+struct MNIST_rle {
+    std::vector<uint8_t> data;      ///< The encoded tokens of all the images
+    std::vector<uint64_t> offsets;  ///< The start of each image inside data (size() + 1 elements)
+    std::size_t features = 0;       ///< The number of pixels of a decoded image
+
+    /*!
+     * \brief Construct an empty store for images of the given size
+     */
+    explicit MNIST_rle(std::size_t features = 0) : offsets(1, 0), features(features) {
+        //Nothing else to init
+    }
+
+    /*!
+     * \brief Return the number of images
+     */
+    std::size_t size() const {
+        return offsets.size() - 1;
+    }
+
+    /*!
+     * \brief Return the number of bytes used by the encoded images
+     */
+    std::size_t encoded_bytes() const {
+        return data.size();
+    }
+
+    /*!
+     * \brief Encode an image at the end of the store
+     * \param image The dense image (features pixels)
+     */
+    void push_back(const uint8_t* image) {
+        std::size_t j = 0;
+
+        while (j < features) {
+            std::size_t zeros = 0;
+            while (j < features && zeros < 255 && image[j] == 0) {
+                ++zeros;
+                ++j;
+            }
+
+            std::size_t literals = 0;
+            while (j + literals < features && literals < 255 && image[j + literals] != 0) {
+                ++literals;
+            }
+
+            data.push_back(static_cast<uint8_t>(zeros));
+            data.push_back(static_cast<uint8_t>(literals));
+            data.insert(data.end(), image + j, image + j + literals);
+
+            j += literals;
+        }
+
+        offsets.push_back(data.size());
+    }
+
+    /*!
+     * \brief Decode the ith image
+     * \param i The index of the image
+     * \param dst The output dense image (features pixels)
+     */
+    void decode(std::size_t i, uint8_t* dst) const {
+        const uint8_t* src = data.data() + offsets[i];
+        const uint8_t* end = data.data() + offsets[i + 1];
+
+        while (src < end) {
+            std::size_t zeros    = src[0];
+            std::size_t literals = src[1];
+            src += 2;
+
+            std::memset(dst, 0, zeros);
+            dst += zeros;
+
+            std::memcpy(dst, src, literals);
+            dst += literals;
+            src += literals;
+        }
+    }
+
+    /*!
+     * \brief Decode a range of images into a contiguous batch
+     * \param first The index of the first image
+     * \param n The number of images
+     * \param dst The output batch (n * features pixels)
+     */
+    void decode_range(std::size_t first, std::size_t n, uint8_t* dst) const {
+        for (std::size_t i = 0; i < n; ++i) {
+            decode(first + i, dst + i * features);
+        }
+    }
+
+    /*!
+     * \brief Decode a set of images into a contiguous batch
+     * \param indices The indices of the images
+     * \param n The number of images
+     * \param dst The output batch (n * features pixels)
+     */
+    void decode_batch(const std::size_t* indices, std::size_t n, uint8_t* dst) const {
+        for (std::size_t i = 0; i < n; ++i) {
+            decode(indices[i], dst + i * features);
+        }
+    }
+};
+
+/*!
+ * \brief Encode contiguous dense images
+ * \param rle The store to fill
+ * \param images The contiguous dense images
+ * \param count The number of images
+ * \param features The number of pixels of each image
+ */
+inline void make_rle(MNIST_rle& rle, const uint8_t* images, std::size_t count, std::size_t features) {
+    rle = MNIST_rle(features);
+    rle.offsets.reserve(count + 1);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        rle.push_back(images + i * features);
+    }
+}
+
+/*!
+ * \brief Read a MNIST image file directly into a run-length encoded store
+ * \param rle The store to fill
+ * \param path The path to the image file
+ * \param limit The maximum number of elements to read (0: no limit)
+ * \return true on success, false otherwise
+ */
+inline bool read_mnist_rle_file(MNIST_rle& rle, const std::string& path, std::size_t limit = 0) {
+    auto buffer = read_mnist_file(path, 0x803);
+
+    if (buffer) {
+        auto count   = read_header(buffer, 1);
+        auto rows    = read_header(buffer, 2);
+        auto columns = read_header(buffer, 3);
+
+        //Skip the header
+        //Cast to unsigned char is necessary cause signedness of char is
+        //platform-specific
+        auto image_buffer = reinterpret_cast<unsigned char*>(buffer.get() + 16);
+
+        if (limit > 0 && count > limit) {
+            count = static_cast<unsigned int>(limit);
+        }
+
+        make_rle(rle, image_buffer, count, rows * columns);
+
+        return true;
+    } else {
+        return false;
+    }
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,114 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains the small SIMD kernels shared by the feature extractors
+ */
+
+#ifndef MNIST_SIMD_HPP
+#define MNIST_SIMD_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace mnist {
+
+namespace detail {
+
+/*!
+ * \brief Compute the dot product of two float vectors
+ */
+inline float dot(const float* a, const float* b, std::size_t n) {
+    std::size_t j = 0;
+    float result  = 0.0f;
+
+#ifdef __SSE2__
+    __m128 s0 = _mm_setzero_ps();
+    __m128 s1 = _mm_setzero_ps();
+
+    for (; j + 8 <= n; j += 8) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(b + j)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + j + 4), _mm_loadu_ps(b + j + 4)));
+    }
+
+    float partial[4];
+    _mm_storeu_ps(partial, _mm_add_ps(s0, s1));
+    result = (partial[0] + partial[1]) + (partial[2] + partial[3]);
+#endif
+
+    for (; j < n; ++j) {
+        result += a[j] * b[j];
+    }
+
+    return result;
+}
+
+/*!
+ * \brief Compute a += alpha * b on float vectors
+ */
+inline void axpy(float* a, float alpha, const float* b, std::size_t n) {
+    std::size_t j = 0;
+
+#ifdef __SSE2__
+    const __m128 s = _mm_set1_ps(alpha);
+
+    for (; j + 4 <= n; j += 4) {
+        _mm_storeu_ps(a + j, _mm_add_ps(_mm_loadu_ps(a + j), _mm_mul_ps(s, _mm_loadu_ps(b + j))));
+    }
+#endif
+
+    for (; j < n; ++j) {
+        a[j] += alpha * b[j];
+    }
+}
+
+/*!
+ * \brief Convert a vector of pixels to float
+ */
+template <typename T>
+void to_float(const T* src, std::size_t n, float* dst) {
+    for (std::size_t j = 0; j < n; ++j) {
+        dst[j] = static_cast<float>(src[j]);
+    }
+}
+
+/*!
+ * \brief Convert a vector of bytes to float
+ */
+inline void to_float(const uint8_t* src, std::size_t n, float* dst) {
+    std::size_t j = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; j + 16 <= n; j += 16) {
+        __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + j));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+        _mm_storeu_ps(dst + j, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_ps(dst + j + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_ps(dst + j + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_ps(dst + j + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+    }
+#endif
+
+    for (; j < n; ++j) {
+        dst[j] = static_cast<float>(src[j]);
+    }
+}
+
+} //end of namespace detail
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,339 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains a sparse (CSR) representation of the MNIST images
+ */
+
+#ifndef MNIST_SPARSE_HPP
+#define MNIST_SPARSE_HPP
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "mnist_reader_common.hpp"
+
+namespace mnist {
+
+/*!
+ * \brief A set of images stored in Compressed Sparse Row format
+ *
+ * The non-zero pixels of image i are values[row_pointers[i]] to
+ * values[row_pointers[i + 1] - 1] and their positions inside the image are
+ * stored at the same indices in columns.
+ */
+struct MNIST_csr {
+    std::vector<std::size_t> row_pointers; ///< The start of each image (count + 1 elements)
+    std::vector<uint16_t> columns;         ///< The pixel index of each non-zero value
+    std::vector<uint8_t> values;           ///< The non-zero values
+    std::size_t features = 0;              ///< The number of pixels of a dense image
+
+    /*!
+     * \brief Return the number of images
+     */
+    std::size_t size() const {
+        return row_pointers.empty() ? 0 : row_pointers.size() - 1;
+    }
+
+    /*!
+     * \brief Return the number of non-zero values of the ith image
+     */
+    std::size_t non_zeros(std::size_t i) const {
+        return row_pointers[i + 1] - row_pointers[i];
+    }
+};
+
+namespace detail {
+
+/*!
+ * \brief Return the index of the lowest set bit of a non-zero mask
+ */
+inline unsigned lowest_bit(uint32_t mask) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+    unsigned i = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+/*!
+ * \brief Return the number of set bits of the mask
+ */
+inline unsigned popcount(uint32_t mask) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_popcount(mask));
+#else
+    unsigned n = 0;
+    for (; mask; mask &= mask - 1) {
+        ++n;
+    }
+    return n;
+#endif
+}
+
+/*!
+ * \brief Count the non-zero bytes of the given buffer
+ */
+inline std::size_t count_non_zeros(const uint8_t* data, std::size_t n) {
+    std::size_t nnz = 0;
+    std::size_t j   = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; j + 16 <= n; j += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j));
+        nnz += popcount(~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero))) & 0xFFFF);
+    }
+#endif
+
+    for (; j < n; ++j) {
+        nnz += data[j] != 0;
+    }
+
+    return nnz;
+}
+
+/*!
+ * \brief Append the non-zero bytes of the given buffer and their indices
+ * \return The number of written values
+ */
+inline std::size_t gather_non_zeros(const uint8_t* data, std::size_t n, uint16_t* columns, uint8_t* values) {
+    std::size_t k = 0;
+    std::size_t j = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; j + 16 <= n; j += 16) {
+        __m128i v     = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j));
+        uint32_t mask = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero))) & 0xFFFF;
+
+        while (mask) {
+            auto bit     = lowest_bit(mask);
+            columns[k]   = static_cast<uint16_t>(j + bit);
+            values[k++]  = data[j + bit];
+            mask        &= mask - 1;
+        }
+    }
+#endif
+
+    for (; j < n; ++j) {
+        if (data[j]) {
+            columns[k]  = static_cast<uint16_t>(j);
+            values[k++] = data[j];
+        }
+    }
+
+    return k;
+}
+
+} //end of namespace detail
+
+/*!
+ * \brief Convert contiguous dense images to CSR
+ * \param csr The sparse images to fill
+ * \param images The contiguous dense images
+ * \param count The number of images
+ * \param features The number of pixels of each image (at most 65536)
+ * \return true on success, false if the images are too large
+ */
+inline bool make_csr(MNIST_csr& csr, const uint8_t* images, std::size_t count, std::size_t features) {
+    if (features > 65536) {
+        std::cout << "The images are too large to be stored in CSR format" << std::endl;
+        return false;
+    }
+
+    csr.features = features;
+    csr.row_pointers.resize(count + 1);
+
+    // First pass: count the non-zeros to allocate the exact storage
+
+    std::size_t nnz = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        csr.row_pointers[i] = nnz;
+        nnz += detail::count_non_zeros(images + i * features, features);
+    }
+    csr.row_pointers[count] = nnz;
+
+    // Second pass: gather the non-zeros
+
+    csr.columns.resize(nnz);
+    csr.values.resize(nnz);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        auto start = csr.row_pointers[i];
+        detail::gather_non_zeros(images + i * features, features, csr.columns.data() + start, csr.values.data() + start);
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Read a MNIST image file directly in CSR format
+ * \param csr The sparse images to fill
+ * \param path The path to the image file
+ * \param limit The maximum number of elements to read (0: no limit)
+ * \return true on success, false otherwise
+ */
+inline bool read_mnist_csr_file(MNIST_csr& csr, const std::string& path, std::size_t limit = 0) {
+    auto buffer = read_mnist_file(path, 0x803);
+
+    if (buffer) {
+        auto count   = read_header(buffer, 1);
+        auto rows    = read_header(buffer, 2);
+        auto columns = read_header(buffer, 3);
+
+        //Skip the header
+        //Cast to unsigned char is necessary cause signedness of char is
+        //platform-specific
+        auto image_buffer = reinterpret_cast<unsigned char*>(buffer.get() + 16);
+
+        if (limit > 0 && count > limit) {
+            count = static_cast<unsigned int>(limit);
+        }
+
+        return make_csr(csr, image_buffer, count, rows * columns);
+    } else {
+        return false;
+    }
+}
+
+/*!
+ * \brief Compute the dot product of a sparse image with a dense vector
+ * \param csr The sparse images
+ * \param i The index of the image
+ * \param dense The dense vector (csr.features elements)
+ * \return the dot product
+ */
+template <typename T>
+T sparse_dot(const MNIST_csr& csr, std::size_t i, const T* dense) {
+    T result = 0;
+    for (auto k = csr.row_pointers[i]; k < csr.row_pointers[i + 1]; ++k) {
+        result += static_cast<T>(csr.values[k]) * dense[csr.columns[k]];
+    }
+    return result;
+}
+
+/*!
+ * \brief Compute the dot product of two sparse images
+ * \param a The first set of sparse images
+ * \param i The index of the image in the first set
+ * \param b The second set of sparse images
+ * \param j The index of the image in the second set
+ * \return the dot product
+ */
+inline uint64_t sparse_dot(const MNIST_csr& a, std::size_t i, const MNIST_csr& b, std::size_t j) {
+    uint64_t result = 0;
+
+    auto ka = a.row_pointers[i];
+    auto kb = b.row_pointers[j];
+
+    while (ka < a.row_pointers[i + 1] && kb < b.row_pointers[j + 1]) {
+        if (a.columns[ka] == b.columns[kb]) {
+            result += static_cast<uint32_t>(a.values[ka++]) * b.values[kb++];
+        } else if (a.columns[ka] < b.columns[kb]) {
+            ++ka;
+        } else {
+            ++kb;
+        }
+    }
+
+    return result;
+}
+
+/*!
+ * \brief Compute the squared euclidean norm of a sparse image
+ */
+inline uint64_t sparse_squared_norm(const MNIST_csr& csr, std::size_t i) {
+    uint64_t result = 0;
+    for (auto k = csr.row_pointers[i]; k < csr.row_pointers[i + 1]; ++k) {
+        result += static_cast<uint32_t>(csr.values[k]) * csr.values[k];
+    }
+    return result;
+}
+
+/*!
+ * \brief Compute the squared euclidean distance between two sparse images
+ * \param a The first set of sparse images
+ * \param i The index of the image in the first set
+ * \param b The second set of sparse images
+ * \param j The index of the image in the second set
+ * \return the squared distance
+ */
+inline uint64_t sparse_squared_distance(const MNIST_csr& a, std::size_t i, const MNIST_csr& b, std::size_t j) {
+    uint64_t result = 0;
+
+    auto ka = a.row_pointers[i];
+    auto kb = b.row_pointers[j];
+
+    const auto ea = a.row_pointers[i + 1];
+    const auto eb = b.row_pointers[j + 1];
+
+    while (ka < ea && kb < eb) {
+        int64_t d;
+        if (a.columns[ka] == b.columns[kb]) {
+            d = static_cast<int64_t>(a.values[ka++]) - b.values[kb++];
+        } else if (a.columns[ka] < b.columns[kb]) {
+            d = a.values[ka++];
+        } else {
+            d = b.values[kb++];
+        }
+        result += static_cast<uint64_t>(d * d);
+    }
+
+    for (; ka < ea; ++ka) {
+        result += static_cast<uint32_t>(a.values[ka]) * a.values[ka];
+    }
+
+    for (; kb < eb; ++kb) {
+        result += static_cast<uint32_t>(b.values[kb]) * b.values[kb];
+    }
+
+    return result;
+}
+
+/*!
+ * \brief Compute the squared euclidean distance between a sparse image and a dense vector
+ *
+ * The squared norm of the dense vector must be given, which allows to
+ * only visit the non-zero values of the sparse image.
+ *
+ * \param csr The sparse images
+ * \param i The index of the image
+ * \param dense The dense vector (csr.features elements)
+ * \param dense_squared_norm The squared norm of the dense vector
+ * \return the squared distance
+ */
+template <typename T>
+T sparse_squared_distance(const MNIST_csr& csr, std::size_t i, const T* dense, T dense_squared_norm) {
+    T result = dense_squared_norm;
+    for (auto k = csr.row_pointers[i]; k < csr.row_pointers[i + 1]; ++k) {
+        T v = static_cast<T>(csr.values[k]);
+        T d = dense[csr.columns[k]];
+        result += v * v - 2 * v * d;
+    }
+    return result;
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,499 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains a buffer bounded by a memory budget, spilling to disk
+ *
+ * When the buffer fits in the budget, it is simply kept in memory. When it
+ * does not, it is backed by a scratch file mapped in memory. The buffer is
+ * divided in chunks and the accesses go through pin() and unpin(), which
+ * keep at most budget bytes of chunks resident: the coldest chunks (clock
+ * algorithm) are written back to the scratch file and dropped from
+ * memory, and they are paged back in on demand by the next access.
+ *
+ * The decoded pixels of an image file can be stored in such a buffer and
+ * the batches of the loader gathered from it, so that a job runs with the
+ * same code on small and large machines.
+ *
+ * On systems without mmap, the buffer is always kept in memory.
+ */
+
+#ifndef MNIST_SPILL_HPP
+#define MNIST_SPILL_HPP
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#include "mnist_mmap.hpp"
+
+namespace mnist {
+
+/*!
+ * \brief A buffer that spills its cold chunks to a scratch file past a memory budget
+ */
+struct spill_buffer {
+    spill_buffer() = default;
+
+    spill_buffer(const spill_buffer&) = delete;
+    spill_buffer& operator=(const spill_buffer&) = delete;
+
+    ~spill_buffer() {
+        release();
+    }
+
+    /*!
+     * \brief Allocate the buffer
+     * \param size The size of the buffer, in bytes
+     * \param budget The maximum number of bytes kept in memory
+     * \param scratch_dir The directory of the scratch file
+     * \param chunk_size The size of the chunks, in bytes
+     * \return true on success, false otherwise
+     */
+    bool allocate(std::size_t size, std::size_t budget, const std::string& scratch_dir = "/tmp", std::size_t chunk_size = 4 * 1024 * 1024) {
+        release();
+
+        if (!size) {
+            return true;
+        }
+
+#ifdef MNIST_HAS_MMAP
+        if (size > budget) {
+            chunk = std::max<std::size_t>(chunk_size / 4096, 1) * 4096;
+
+            std::string name = scratch_dir + "/mnist_spill_XXXXXX";
+
+            fd = mkstemp(&name[0]);
+
+            if (fd < 0) {
+                std::cout << "Unable to create the scratch file" << std::endl;
+                return false;
+            }
+
+            // The file is removed as soon as it is closed
+            unlink(name.c_str());
+
+            if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                std::cout << "Unable to create the scratch file" << std::endl;
+                release();
+                return false;
+            }
+
+            void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+            if (address == MAP_FAILED) {
+                std::cout << "Unable to map the scratch file" << std::endl;
+                release();
+                return false;
+            }
+
+            start  = static_cast<char*>(address);
+            length = size;
+
+            std::size_t chunks = (size + chunk - 1) / chunk;
+
+            max_resident = std::max<std::size_t>(budget / chunk, 1);
+            resident.assign(chunks, 0);
+            referenced.assign(chunks, 0);
+            pins.assign(chunks, 0);
+
+            return true;
+        }
+#else
+        (void)scratch_dir;
+        (void)chunk_size;
+#endif
+
+        (void)budget;
+
+        memory.reset(new char[size]());
+        start  = memory.get();
+        length = size;
+
+        return true;
+    }
+
+    /*!
+     * \brief Release the buffer and its scratch file
+     */
+    void release() {
+#ifdef MNIST_HAS_MMAP
+        if (fd >= 0) {
+            if (start) {
+                munmap(start, length);
+            }
+
+            ::close(fd);
+        }
+#endif
+
+        memory.reset();
+
+        fd             = -1;
+        start          = nullptr;
+        length         = 0;
+        chunk          = 0;
+        max_resident   = 0;
+        resident_count = 0;
+        hand           = 0;
+
+        resident.clear();
+        referenced.clear();
+        pins.clear();
+    }
+
+    /*!
+     * \brief Pin a range of the buffer in memory
+     *
+     * The chunks of the range are marked as recently used and are paged in
+     * if necessary, evicting cold chunks to stay within the budget. Pinned
+     * chunks are never evicted, so the returned pointer can be used until
+     * the range is unpinned. When all the resident chunks are pinned, the
+     * budget is exceeded until some of them are unpinned.
+     *
+     * \param offset The offset of the range, in bytes
+     * \param size The size of the range, in bytes
+     * \return A pointer to the range
+     */
+    char* pin(std::size_t offset, std::size_t size) {
+        if (spilled() && size) {
+            std::vector<std::size_t> evicted;
+
+            {
+                std::lock_guard<std::mutex> l(lock);
+
+                for (std::size_t c = offset / chunk; c <= (offset + size - 1) / chunk; ++c) {
+                    referenced[c] = 1;
+                    ++pins[c];
+
+                    if (!resident[c]) {
+                        while (resident_count >= max_resident && evict_one(evicted)) {}
+
+                        resident[c] = 1;
+                        ++resident_count;
+                    }
+                }
+            }
+
+            // The pages are dropped outside of the lock, the content stays
+            // in the scratch file if a chunk is accessed again meanwhile
+            for (auto c : evicted) {
+                drop_chunk(c);
+            }
+        }
+
+        return start + offset;
+    }
+
+    /*!
+     * \brief Unpin a range of the buffer previously pinned with pin()
+     * \param offset The offset of the range, in bytes
+     * \param size The size of the range, in bytes
+     */
+    void unpin(std::size_t offset, std::size_t size) {
+        if (spilled() && size) {
+            std::lock_guard<std::mutex> l(lock);
+
+            for (std::size_t c = offset / chunk; c <= (offset + size - 1) / chunk; ++c) {
+                --pins[c];
+            }
+        }
+    }
+
+    /*!
+     * \brief Copy a range of the buffer
+     * \param offset The offset of the range, in bytes
+     * \param size The size of the range, in bytes
+     * \param out The output buffer (size bytes)
+     */
+    void read(std::size_t offset, std::size_t size, void* out) {
+        const char* range = pin(offset, size);
+        std::copy(range, range + size, static_cast<char*>(out));
+        unpin(offset, size);
+    }
+
+    /*!
+     * \brief Copy data into a range of the buffer
+     * \param offset The offset of the range, in bytes
+     * \param size The size of the range, in bytes
+     * \param in The data to copy (size bytes)
+     */
+    void write(std::size_t offset, std::size_t size, const void* in) {
+        char* range = pin(offset, size);
+        std::copy(static_cast<const char*>(in), static_cast<const char*>(in) + size, range);
+        unpin(offset, size);
+    }
+
+    /*!
+     * \brief Return the size of the buffer
+     */
+    std::size_t size() const {
+        return length;
+    }
+
+    /*!
+     * \brief Indicates if the buffer is backed by a scratch file
+     */
+    bool spilled() const {
+        return fd >= 0;
+    }
+
+    /*!
+     * \brief Return the number of bytes of chunks currently kept in memory
+     */
+    std::size_t resident_bytes() const {
+        std::lock_guard<std::mutex> l(lock);
+        return spilled() ? std::min(resident_count * chunk, length) : length;
+    }
+
+private:
+    /*!
+     * \brief Evict the first resident chunk neither pinned nor recently used
+     * \param evicted The evicted chunks, whose pages must then be dropped
+     * \return true if a chunk was evicted, false if all the resident chunks are pinned
+     */
+    bool evict_one(std::vector<std::size_t>& evicted) {
+        // The references are cleared during the first round
+        for (std::size_t i = 0; i < 2 * resident.size(); ++i) {
+            std::size_t c = hand;
+            hand = (hand + 1) % resident.size();
+
+            if (!resident[c] || pins[c]) {
+                continue;
+            }
+
+            if (referenced[c]) {
+                referenced[c] = 0;
+                continue;
+            }
+
+            resident[c] = 0;
+            --resident_count;
+
+            evicted.push_back(c);
+
+            return true;
+        }
+
+        return false;
+    }
+
+    /*!
+     * \brief Drop the pages of a chunk from the memory
+     *
+     * The write-back of the dirty pages is only started, they are reclaimed
+     * by the kernel once written instead of waiting for each chunk.
+     */
+    void drop_chunk(std::size_t c) {
+#ifdef MNIST_HAS_MMAP
+        std::size_t begin = c * chunk;
+        std::size_t n     = std::min(chunk, length - begin);
+
+#ifdef SYNC_FILE_RANGE_WRITE
+        sync_file_range(fd, static_cast<off_t>(begin), static_cast<off_t>(n), SYNC_FILE_RANGE_WRITE);
+#endif
+
+#ifdef MADV_PAGEOUT
+        if (madvise(start + begin, n, MADV_PAGEOUT) != 0) {
+            madvise(start + begin, n, MADV_DONTNEED);
+        }
+#else
+        madvise(start + begin, n, MADV_DONTNEED);
+#endif
+
+#ifdef POSIX_FADV_DONTNEED
+        posix_fadvise(fd, static_cast<off_t>(begin), static_cast<off_t>(n), POSIX_FADV_DONTNEED);
+#endif
+#else
+        (void)c;
+#endif
+    }
+
+    char* start        = nullptr;   ///< The content of the buffer
+    std::size_t length = 0;         ///< The size of the buffer
+    int fd             = -1;        ///< The scratch file
+    std::size_t chunk  = 0;         ///< The size of the chunks
+    std::unique_ptr<char[]> memory; ///< The content, when it fits in the budget
+
+    std::size_t max_resident   = 0; ///< The maximum number of resident chunks
+    std::size_t resident_count = 0; ///< The number of resident chunks
+    std::size_t hand           = 0; ///< The hand of the clock
+    std::vector<uint8_t> resident;   ///< Indicates if each chunk is resident
+    std::vector<uint8_t> referenced; ///< Indicates if each chunk was recently used
+    std::vector<uint32_t> pins;      ///< The number of pins of each chunk
+
+    mutable std::mutex lock;
+};
+
+/*!
+ * \brief Read a MNIST file inside a buffer bounded by a memory budget
+ *
+ * The file is read chunk by chunk, so that the budget is also respected
+ * during the read.
+ *
+ * \param buffer The buffer to fill
+ * \param path The path to the MNIST file
+ * \param key The expected magic number
+ * \param budget The maximum number of bytes kept in memory
+ * \param scratch_dir The directory of the scratch file
+ * \return true on success, false otherwise
+ */
+inline bool read_mnist_file(spill_buffer& buffer, const std::string& path, uint32_t key, std::size_t budget, const std::string& scratch_dir = "/tmp") {
+    constexpr std::size_t read_size = 4 * 1024 * 1024;
+
+    std::ifstream file;
+    file.open(path, std::ios::in | std::ios::binary | std::ios::ate);
+
+    if (!file) {
+        std::cout << "Error opening file" << std::endl;
+        return false;
+    }
+
+    auto size = static_cast<std::size_t>(file.tellg());
+
+    if (!buffer.allocate(size, budget, scratch_dir, read_size)) {
+        return false;
+    }
+
+    file.seekg(0, std::ios::beg);
+
+    for (std::size_t offset = 0; offset < size; offset += read_size) {
+        std::size_t n = std::min(read_size, size - offset);
+
+        bool ok = static_cast<bool>(file.read(buffer.pin(offset, n), n));
+        buffer.unpin(offset, n);
+
+        if (!ok) {
+            std::cout << "Error reading file" << std::endl;
+            return false;
+        }
+    }
+
+    char header[16] = {};
+    buffer.read(0, std::min<std::size_t>(size, 16), header);
+
+    return check_mnist_buffer(header, size, key);
+}
+
+/*!
+ * \brief Read the decoded pixels of a MNIST image file inside a buffer bounded by a memory budget
+ *
+ * The pixels of the images are stored contiguously, image i starts at the
+ * byte i * image_size * sizeof(Pixel) of the buffer. The file is decoded
+ * chunk by chunk, so that neither the file nor the decoded pixels are
+ * entirely kept in memory.
+ *
+ * \param buffer The buffer to fill
+ * \param path The path to the image file
+ * \param image_size The output number of pixels of each image
+ * \param budget The maximum number of bytes kept in memory
+ * \param scratch_dir The directory of the scratch file
+ * \param limit The maximum number of images to read (0: no limit)
+ * \return true on success, false otherwise
+ */
+template <typename Pixel>
+bool read_mnist_pixels(spill_buffer& buffer, const std::string& path, std::size_t& image_size, std::size_t budget, const std::string& scratch_dir = "/tmp", std::size_t limit = 0) {
+    constexpr std::size_t read_size = 1024 * 1024;
+
+    std::ifstream file;
+    file.open(path, std::ios::in | std::ios::binary | std::ios::ate);
+
+    if (!file) {
+        std::cout << "Error opening file" << std::endl;
+        return false;
+    }
+
+    auto size = static_cast<std::size_t>(file.tellg());
+
+    char header[16] = {};
+
+    file.seekg(0, std::ios::beg);
+    file.read(header, std::min<std::size_t>(size, 16));
+
+    if (!file || !check_mnist_buffer(header, size, 0x803)) {
+        return false;
+    }
+
+    std::size_t count = read_header(header, 1);
+
+    if (limit > 0 && count > limit) {
+        count = limit;
+    }
+
+    image_size = std::size_t(read_header(header, 2)) * read_header(header, 3);
+
+    const std::size_t pixels = count * image_size;
+
+    // The batches access random images, small chunks avoid paging in
+    // much more than the accessed images
+    const std::size_t chunk_size = std::max<std::size_t>(4 * image_size * sizeof(Pixel), 4096);
+
+    if (!buffer.allocate(pixels * sizeof(Pixel), budget, scratch_dir, chunk_size)) {
+        return false;
+    }
+
+    std::vector<unsigned char> bytes(read_size);
+
+    for (std::size_t first = 0; first < pixels; first += read_size) {
+        std::size_t n = std::min(read_size, pixels - first);
+
+        if (!file.read(reinterpret_cast<char*>(bytes.data()), n)) {
+            std::cout << "Error reading file" << std::endl;
+            return false;
+        }
+
+        auto out = reinterpret_cast<Pixel*>(buffer.pin(first * sizeof(Pixel), n * sizeof(Pixel)));
+        decode_bytes(bytes.data(), n, out);
+        buffer.unpin(first * sizeof(Pixel), n * sizeof(Pixel));
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Gather records of a spill buffer into a contiguous batch
+ * \param buffer The buffer containing the records
+ * \param offset The offset of the first record (16 for an image file, 8 for a label file)
+ * \param record_size The size of each record, in bytes
+ * \param indices The indices of the records to gather
+ * \param out The output records (indices.size() * record_size bytes)
+ */
+inline void gather_records(spill_buffer& buffer, std::size_t offset, std::size_t record_size, const std::vector<std::size_t>& indices, uint8_t* out) {
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        buffer.read(offset + indices[i] * record_size, record_size, out + i * record_size);
+    }
+}
+
+/*!
+ * \brief Gather the samples of a batch of the loader from pixels stored in a spill buffer
+ * \param images The buffer filled by read_mnist_pixels
+ * \param labels The labels of the dataset
+ * \param image_size The number of pixels of each image
+ * \param indices The indices of the samples of the batch
+ * \param batch_images The output images (indices.size() * image_size pixels)
+ * \param batch_labels The output labels (indices.size() labels)
+ */
+template <typename Pixel, typename Label>
+void gather_batch(spill_buffer& images, const Label* labels, std::size_t image_size, const std::vector<std::size_t>& indices, Pixel* batch_images, Label* batch_labels) {
+    const std::size_t image_bytes = image_size * sizeof(Pixel);
+
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        images.read(indices[i] * image_bytes, image_bytes, batch_images + i * image_size);
+        batch_labels[i] = labels[indices[i]];
+    }
+}
+
+} //end of namespace mnist
+
+#endif
@@ -0,0 +1,504 @@
+//=======================================================================
+// Copyright (c) 2014-2016 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Contains an io_uring backend to read several MNIST files at once
+ *
+ * The ring is driven with raw system calls, no library is necessary. All
+ * the files are read in chunks through one ring, which keeps the device
+ * queue full, and each file is handed to the caller as soon as it is
+ * complete so that it can be decoded while the others are still read. The
+ * overlap between reading and decoding is per file, not per chunk.
+ *
+ * When io_uring is not available (other systems, kernels without
+ * IORING_OP_READ or restricted containers), the files are read one by one
+ * with read_mnist_file.
+ */
+
+#ifndef MNIST_URING_HPP
+#define MNIST_URING_HPP
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define MNIST_HAS_URING
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+#include "mnist_reader_common.hpp"
+
+namespace mnist {
+
+#ifdef MNIST_HAS_URING
+
+/*!
+ * \brief A minimal io_uring instance, only able to submit reads
+ */
+struct uring {
+    uring() = default;
+
+    uring(const uring&) = delete;
+    uring& operator=(const uring&) = delete;
+
+    ~uring() {
+        if (sq_ring && sq_ring != MAP_FAILED) {
+            munmap(sq_ring, sq_ring_size);
+        }
+        if (cq_ring && cq_ring != sq_ring && cq_ring != MAP_FAILED) {
+            munmap(cq_ring, cq_ring_size);
+        }
+        if (sqes && sqes != MAP_FAILED) {
+            munmap(sqes, sqes_size);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    /*!
+     * \brief Create the ring
+     * \param entries The number of entries of the submission queue
+     * \return true on success, false if io_uring is not available
+     */
+    bool init(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+
+        if (fd < 0) {
+            return false;
+        }
+
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+        }
+
+        sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+
+        if (sq_ring == MAP_FAILED) {
+            return false;
+        }
+
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            cq_ring = sq_ring;
+        } else {
+            cq_ring = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+
+            if (cq_ring == MAP_FAILED) {
+                return false;
+            }
+        }
+
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes      = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+
+        auto sq = static_cast<char*>(sq_ring);
+        auto cq = static_cast<char*>(cq_ring);
+
+        sq_head  = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask  = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask  = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes     = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        capacity = params.sq_entries;
+
+        return supports_read();
+    }
+
+    /*!
+     * \brief Indicates if the kernel supports IORING_OP_READ (Linux 5.6)
+     */
+    bool supports_read() const {
+#ifdef IO_URING_OP_SUPPORTED // IORING_REGISTER_PROBE is an enumerator
+        const unsigned ops = 256;
+
+        std::vector<char> storage(sizeof(io_uring_probe) + ops * sizeof(io_uring_probe_op), 0);
+        auto probe = reinterpret_cast<io_uring_probe*>(storage.data());
+
+        // The probe itself was added with IORING_OP_READ, it fails on older kernels
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, ops) < 0) {
+            return false;
+        }
+
+        return probe->last_op >= IORING_OP_READ && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+#else
+        return false;
+#endif
+    }
+
+    /*!
+     * \brief Return the maximum number of reads in flight
+     */
+    unsigned entries() const {
+        return capacity;
+    }
+
+    /*!
+     * \brief Queue a read, submitted with the next call to submit_and_wait
+     */
+    void prepare_read(int file, char* buffer, std::size_t length, uint64_t offset, uint64_t user_data) {
+        unsigned tail = *sq_tail + pending;
+        unsigned idx  = tail & sq_mask;
+
+        io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes) + idx;
+        std::memset(sqe, 0, sizeof(*sqe));
+
+        sqe->opcode    = IORING_OP_READ;
+        sqe->fd        = file;
+        sqe->addr      = reinterpret_cast<uint64_t>(buffer);
+        sqe->len       = static_cast<uint32_t>(length);
+        sqe->off       = offset;
+        sqe->user_data = user_data;
+
+        sq_array[idx] = idx;
+        ++pending;
+    }
+
+    /*!
+     * \brief Drop the queued reads that the kernel has not consumed
+     *
+     * This must only be called after a failed submit_and_wait.
+     *
+     * \return The number of dropped reads
+     */
+    unsigned discard_unsubmitted() {
+        unsigned head    = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        unsigned dropped = *sq_tail + pending - head;
+
+        __atomic_store_n(sq_tail, head, __ATOMIC_RELEASE);
+        pending = 0;
+
+        return dropped;
+    }
+
+    /*!
+     * \brief Submit the queued reads and wait for at least one completion
+     * \return true on success, false otherwise
+     */
+    bool submit_and_wait() {
+        __atomic_store_n(sq_tail, *sq_tail + pending, __ATOMIC_RELEASE);
+
+        unsigned to_submit = pending;
+        pending            = 0;
+
+        while (true) {
+            auto ret = syscall(__NR_io_uring_enter, fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+
+            if (ret >= 0) {
+                return true;
+            }
+
+            if (errno != EINTR) {
+                return false;
+            }
+
+            // The entries have been consumed even if the wait was interrupted
+            to_submit = 0;
+        }
+    }
+
+    /*!
+     * \brief Wait for at least one completion, without submitting anything
+     * \return true on success, false otherwise
+     */
+    bool wait() {
+        while (true) {
+            if (syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) >= 0) {
+                return true;
+            }
+
+            if (errno != EINTR) {
+                return false;
+            }
+        }
+    }
+
+    /*!
+     * \brief Call func(user_data, result) for each available completion
+     */
+    template <typename Functor>
+    void reap(Functor func) {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+
+        while (head != tail) {
+            const io_uring_cqe& cqe = cqes[head & cq_mask];
+            func(cqe.user_data, cqe.res);
+            ++head;
+        }
+
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+
+private:
+    int fd = -1;
+
+    void* sq_ring = nullptr;
+    void* cq_ring = nullptr;
+    void* sqes    = nullptr;
+
+    std::size_t sq_ring_size = 0;
+    std::size_t cq_ring_size = 0;
+    std::size_t sqes_size    = 0;
+
+    unsigned* sq_head  = nullptr;
+    unsigned* sq_tail  = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head  = nullptr;
+    unsigned* cq_tail  = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    unsigned sq_mask  = 0;
+    unsigned cq_mask  = 0;
+    unsigned capacity = 0;
+    unsigned pending  = 0;
+};
+
+#endif
+
+/*!
+ * \brief Read several MNIST files (or shards) at once with io_uring
+ *
+ * func(i, buffers[i]) is called exactly once for each file, as soon as the
+ * ith file is completely read, so that it can be decoded while the other
+ * files are still read. If a file cannot be read, buffers[i] is a
+ * nullptr-unique_ptr.
+ *
+ * \param paths The paths to the files
+ * \param keys The expected magic number of each file
+ * \param buffers The buffers filled with the content of each file
+ * \param func The functor called when a file is complete
+ * \param queue_depth The maximum number of reads in flight
+ * \param chunk_size The size of each read
+ * \return true if all the files were read successfully, false otherwise
+ */
+template <typename Functor>
+bool read_mnist_files_uring(const std::vector<std::string>& paths, const std::vector<uint32_t>& keys, std::vector<std::unique_ptr<char[]>>& buffers,
+                            Functor func, unsigned queue_depth = 64, std::size_t chunk_size = 1024 * 1024) {
+    buffers.clear();
+    buffers.resize(paths.size());
+
+    bool success = true;
+
+#ifdef MNIST_HAS_URING
+    // The buffers of the failed files, released after the ring, in case
+    // the kernel still writes into them
+    std::vector<std::unique_ptr<char[]>> orphans;
+
+    uring ring;
+
+    if (ring.init(queue_depth)) {
+        struct file_state {
+            int fd                = -1;
+            std::size_t size      = 0;
+            std::size_t next      = 0; // Next offset to submit
+            std::size_t done      = 0; // Number of bytes read
+            std::size_t in_flight = 0; // Number of reads in flight
+            bool failed           = false;
+            bool unsupported      = false; // The read operation was rejected
+            bool finished         = false;
+        };
+
+        struct read_state {
+            std::size_t file;
+            std::size_t offset;
+            std::size_t length;
+        };
+
+        std::vector<file_state> files(paths.size());
+        std::vector<read_state> reads;
+        std::vector<std::size_t> free_slots;
+
+        auto finish = [&](std::size_t i) {
+            auto& f = files[i];
+
+            if (f.finished) {
+                return;
+            }
+
+            f.finished = true;
+
+            if (f.fd >= 0) {
+                ::close(f.fd);
+                f.fd = -1;
+            }
+
+            if (f.unsupported && !f.in_flight) {
+                // The kernel rejected the read operation, read the file synchronously
+                buffers[i] = read_mnist_file(paths[i], keys[i]);
+                success &= static_cast<bool>(buffers[i]);
+            } else if (f.failed || !check_mnist_buffer(buffers[i].get(), f.size, keys[i])) {
+                orphans.push_back(std::move(buffers[i]));
+                success = false;
+            }
+
+            func(i, buffers[i]);
+        };
+
+        auto submit = [&](std::size_t i, std::size_t offset, std::size_t length) {
+            std::size_t slot;
+            if (free_slots.empty()) {
+                slot = reads.size();
+                reads.emplace_back();
+            } else {
+                slot = free_slots.back();
+                free_slots.pop_back();
+            }
+
+            reads[slot] = {i, offset, length};
+            ring.prepare_read(files[i].fd, buffers[i].get() + offset, length, offset, slot);
+
+            ++files[i].in_flight;
+        };
+
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            auto& f = files[i];
+
+            f.fd = ::open(paths[i].c_str(), O_RDONLY);
+
+            struct stat st;
+            if (f.fd < 0 || fstat(f.fd, &st) != 0) {
+                std::cout << "Error opening file" << std::endl;
+                f.failed = true;
+                finish(i);
+                continue;
+            }
+
+            f.size = static_cast<std::size_t>(st.st_size);
+            buffers[i].reset(new char[f.size]);
+
+            if (!f.size) {
+                finish(i);
+            }
+        }
+
+        std::size_t current = 0; // The file currently being submitted
+        std::size_t flight  = 0;
+
+        while (true) {
+            // Fill the queue with the next chunks
+
+            while (flight < ring.entries()) {
+                while (current < files.size() && (files[current].failed || files[current].next >= files[current].size)) {
+                    ++current;
+                }
+
+                if (current == files.size()) {
+                    break;
+                }
+
+                auto& f    = files[current];
+                auto chunk = std::min(chunk_size, f.size - f.next);
+
+                submit(current, f.next, chunk);
+
+                f.next += chunk;
+                ++flight;
+            }
+
+            if (!flight) {
+                break;
+            }
+
+            if (!ring.submit_and_wait()) {
+                std::cout << "io_uring submission failed" << std::endl;
+
+                // Wait for the reads already consumed by the kernel, the
+                // unfinished files are finished as failed below
+                flight -= ring.discard_unsubmitted();
+
+                for (auto& f : files) {
+                    f.failed = true;
+                }
+
+                while (flight && ring.wait()) {
+                    ring.reap([&](uint64_t, int32_t) { --flight; });
+                }
+
+                break;
+            }
+
+            ring.reap([&](uint64_t slot, int32_t res) {
+                auto r  = reads[slot];
+                auto& f = files[r.file];
+
+                free_slots.push_back(slot);
+
+                --flight;
+                --f.in_flight;
+
+                if (res == -EINVAL) {
+                    f.failed      = true;
+                    f.unsupported = true;
+                } else if (res <= 0) {
+                    f.failed = true;
+                } else if (static_cast<std::size_t>(res) < r.length) {
+                    // Short read, queue the remainder
+                    f.done += res;
+                    submit(r.file, r.offset + res, r.length - res);
+                    ++flight;
+                    return;
+                } else {
+                    f.done += res;
+                }
+
+                if (!f.in_flight && (f.failed || f.done == f.size)) {
+                    finish(r.file);
+                }
+            });
+        }
+
+        // After a failure of the ring, some files are not finished yet
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            finish(i);
+        }
+
+        return success;
+    }
+#endif
+
+    // Synchronous fallback
+
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        buffers[i] = read_mnist_file(paths[i], keys[i]);
+        success &= static_cast<bool>(buffers[i]);
+        func(i, buffers[i]);
+    }
+
+    return success;
+}
+
+} //end of namespace mnist
+
+#endif